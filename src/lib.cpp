@@ -1,11 +1,20 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <bit>
 #include <cmath>
+#include <compare>
 #include <cstdint>
+#include <cstring>
+#include <deque>
+#include <initializer_list>
 #include <iostream>
+#include <limits>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 // if you do not plan to implement bonus, you can delete those lines
@@ -17,18 +26,686 @@
 #define CHECK_BIGING_BOUNDS \
   0  // if 1, BigInteger will check bounds on operator[] and throw std::out_of_range if index is out
      // of range
+// [DIGIT_64] - if 1, digits are 64-bit with 128-bit intermediates, else 32-bit with 64-bit ones.
+// Defaults to 1 where the compiler provides unsigned __int128
+#ifndef DIGIT_64
+#ifdef __SIZEOF_INT128__
+#define DIGIT_64 1
+#else
+#define DIGIT_64 0
+#endif
+#endif
+#if DIGIT_64 == 1
+// [digit] - unsigned single digit
+using digit = uint64_t;
+// [d_digit] - unsigned double digit
+__extension__ typedef unsigned __int128 d_digit;
+// [d_idigit] - signed double digit
+__extension__ typedef __int128 d_idigit;
+#else
 // [digit] - unsigned single digit
 using digit = uint32_t;
-// [idigit] - MAX value of signed single digit
-constexpr auto digit_max = UINT32_MAX;
-// [digit_size] - number of bits in digit
-constexpr auto digit_size = UINT32_WIDTH;
 // [d_digit] - unsigned double digit
 using d_digit = uint64_t;
 // [d_idigit] - signed double digit
 using d_idigit = int64_t;
+#endif
+// [digit_max] - MAX value of single digit
+constexpr digit digit_max = std::numeric_limits<digit>::max();
+// [digit_size] - number of bits in digit
+constexpr int digit_size = std::numeric_limits<digit>::digits;
+// [X86_KERNELS] - if 1, x86-64 add/sub kernels (adc chains, AVX-512) are compiled and picked at
+// startup by CPUID. Requires 64-bit digits
+#ifndef X86_KERNELS
+#if DIGIT_64 == 1 && defined(__x86_64__) && defined(__GNUC__)
+#define X86_KERNELS 1
+#else
+#define X86_KERNELS 0
+#endif
+#endif
+#if X86_KERNELS == 1
+#include <immintrin.h>
+#endif
 // [string_base] - base of string representation
 constexpr digit string_base = 10;
+// [decimal_chunk] - number of decimal digits that always fit into one digit
+constexpr size_t decimal_chunk = [] {
+  size_t count = 0;
+  for (digit power = 1; power <= digit_max / 10; power *= 10) ++count;
+  return count;
+}();
+// [decimal_chunk_base] - 10^decimal_chunk, base of decimal conversion
+constexpr digit decimal_chunk_base = [] {
+  digit power = 1;
+  for (size_t i = 0; i < decimal_chunk; ++i) power *= 10;
+  return power;
+}();
+// [decimal_dc_threshold] - min number of decimal digits to convert with divide and conquer
+inline size_t decimal_dc_threshold = 4000;
+// [karatsuba_threshold] - min size in digits of both operands to multiply with Karatsuba, at least 2
+inline size_t karatsuba_threshold = 96;
+// [toom3_threshold] - min size in digits of the smaller operand to multiply with Toom-3
+inline size_t toom3_threshold = 256;
+// [toom4_threshold] - min size in digits of the smaller operand to multiply with Toom-4
+inline size_t toom4_threshold = 512;
+// [ntt_threshold] - min size in digits of the smaller operand to multiply with NTT
+inline size_t ntt_threshold = DIGIT_64 == 1 ? 131072 : 16384;
+// [sqr_karatsuba_threshold] - min size in digits to square with Karatsuba, at least 2
+inline size_t sqr_karatsuba_threshold = 160;
+// [sqr_toom3_threshold] - min size in digits to square with Toom-3
+inline size_t sqr_toom3_threshold = 400;
+// [sqr_toom4_threshold] - min size in digits to square with Toom-4
+inline size_t sqr_toom4_threshold = 1024;
+// [sqr_ntt_threshold] - min size in digits to square with NTT
+inline size_t sqr_ntt_threshold = DIGIT_64 == 1 ? 131072 : 16384;
+// [burnikel_ziegler_threshold] - min size in digits of divisor to divide with Burnikel-Ziegler, at
+// least 1
+inline size_t burnikel_ziegler_threshold = DIGIT_64 == 1 ? 512 : 1024;
+// [hgcd_threshold] - min size in digits of the smaller operand to run the half-gcd recursion
+inline size_t hgcd_threshold = 1000;
+// [special_modulus_threshold] - min size in digits of an odd 2^k +- c modulus for powmod to reduce
+// by folding instead of Montgomery multiplication
+inline size_t special_modulus_threshold = DIGIT_64 == 1 ? 14 : 28;
+// [rational_reduce_threshold] - BigRational results are left unreduced until numerator and
+// denominator together reach this many digits, 0 reduces every result
+inline size_t rational_reduce_threshold = 0;
+// [burnikel_ziegler_offset] - min difference of dividend and divisor sizes for Burnikel-Ziegler
+inline size_t burnikel_ziegler_offset = DIGIT_64 == 1 ? 256 : 512;
+
+// [digit_inline_capacity] - number of digits stored inside BigInteger without heap allocation
+constexpr size_t digit_inline_capacity = 4;
+
+// [digit_resource] - memory resource of this thread for digits that spill to the heap, null means
+// the global heap. A heap block stays with the resource it came from for its whole life
+inline thread_local std::pmr::memory_resource *digit_resource = nullptr;
+
+// Makes {resource} (e.g. a std::pmr::monotonic_buffer_resource) the digit resource of this thread
+// until the scope ends. Numbers whose digits spill to the heap inside the scope must not outlive
+// the resource
+class DigitResourceScope {
+ public:
+  explicit DigitResourceScope(std::pmr::memory_resource *resource) : previous_(digit_resource) {
+    digit_resource = resource;
+  }
+  DigitResourceScope(const DigitResourceScope &) = delete;
+  DigitResourceScope &operator=(const DigitResourceScope &) = delete;
+  ~DigitResourceScope() { digit_resource = previous_; }
+
+ private:
+  std::pmr::memory_resource *previous_;
+};
+
+// [scratch_block_classes] - heap blocks of 2^0 .. 2^(classes - 1) digits are kept for reuse. A
+// thread retains at most scratch_max_digits digits in free blocks until it exits or calls
+// DigitScratch::release()
+constexpr size_t scratch_block_classes = 17;
+// [scratch_blocks_per_class] - max number of free blocks a thread keeps in every size class
+constexpr size_t scratch_blocks_per_class = 16;
+// [scratch_max_digits] - max number of digits in the free blocks of one thread, 2^17 digits are
+// 1 MiB with 64-bit digits. 0 turns the scratch off
+inline size_t scratch_max_digits = size_t(1) << 17;
+
+// Per-thread scratch of freed heap digit blocks. Temporaries of multiplication, division and gcd
+// return their storage here and the next temporary of the same size class borrows it back, so
+// steady-state arithmetic does not touch the global heap. Blocks are powers of two in size
+class DigitScratch {
+ public:
+  // Scratch of this thread, null once the thread is shutting down and the scratch is gone
+  static DigitScratch *local() {
+    if (state == destroyed) return nullptr;
+    thread_local DigitScratch scratch;
+    return &scratch;
+  }
+  // Size class of a block holding at least {count} digits
+  static size_t block_class(size_t count) { return std::bit_width(count - 1); }
+  digit *take(size_t log) {
+    if (log >= scratch_block_classes || free_[log].count == 0) return new digit[size_t(1) << log];
+    retained_ -= size_t(1) << log;
+    return free_[log].blocks[--free_[log].count];
+  }
+  void give(digit *block, size_t log) {
+    if (log >= scratch_block_classes || free_[log].count == scratch_blocks_per_class ||
+        retained_ + (size_t(1) << log) > scratch_max_digits) {
+      delete[] block;
+      return;
+    }
+    retained_ += size_t(1) << log;
+    free_[log].blocks[free_[log].count++] = block;
+  }
+  // Return the free blocks of this thread to the global heap
+  static void release() {
+    if (DigitScratch *scratch = local(); scratch != nullptr) scratch->clear();
+  }
+  // Number of digits in the free blocks of this thread
+  static size_t retained() {
+    DigitScratch *scratch = local();
+    return scratch != nullptr ? scratch->retained_ : 0;
+  }
+  DigitScratch(const DigitScratch &) = delete;
+  DigitScratch &operator=(const DigitScratch &) = delete;
+
+ private:
+  enum State { unused, alive, destroyed };
+  static inline thread_local State state = unused;
+  struct FreeBlocks {
+    digit *blocks[scratch_blocks_per_class];
+    size_t count = 0;
+  };
+
+  DigitScratch() { state = alive; }
+  ~DigitScratch() {
+    clear();
+    state = destroyed;
+  }
+  void clear() {
+    for (auto &list : free_) {
+      for (size_t i = 0; i < list.count; ++i) delete[] list.blocks[i];
+      list.count = 0;
+    }
+    retained_ = 0;
+  }
+
+  FreeBlocks free_[scratch_block_classes];
+  size_t retained_ = 0;
+};
+
+// Storage of digits with small buffer optimization: up to {digit_inline_capacity} digits live
+// inline, longer numbers spill to the heap. Implements the part of std::vector BigInteger uses
+class DigitVector {
+ public:
+  DigitVector() = default;
+  DigitVector(size_t count, digit value) { assign(count, value); }
+  DigitVector(std::initializer_list<digit> values) { assign(values.begin(), values.end()); }
+  DigitVector(const DigitVector &other) { assign(other.begin(), other.end()); }
+  DigitVector(DigitVector &&other) noexcept { steal(other); }
+  DigitVector &operator=(const DigitVector &other) {
+    if (this != &other) assign(other.begin(), other.end());
+    return *this;
+  }
+  DigitVector &operator=(DigitVector &&other) noexcept {
+    if (this != &other) {
+      release();
+      steal(other);
+    }
+    return *this;
+  }
+  DigitVector &operator=(std::initializer_list<digit> values) {
+    assign(values.begin(), values.end());
+    return *this;
+  }
+  ~DigitVector() { release(); }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+  bool is_inline() const { return data_ == inline_; }
+  digit *data() { return data_; }
+  const digit *data() const { return data_; }
+  digit *begin() { return data_; }
+  digit *end() { return data_ + size_; }
+  const digit *begin() const { return data_; }
+  const digit *end() const { return data_ + size_; }
+  digit &operator[](size_t index) { return data_[index]; }
+  const digit &operator[](size_t index) const { return data_[index]; }
+  digit &back() { return data_[size_ - 1]; }
+  const digit &back() const { return data_[size_ - 1]; }
+
+  void reserve(size_t count) {
+    if (count <= capacity_) return;
+    // Growing heap storage stays on its resource, storage leaving the inline buffer takes the
+    // current one
+    std::pmr::memory_resource *resource = is_inline() ? digit_resource : resource_;
+    digit *storage;
+    if (resource != nullptr) {
+      storage = static_cast<digit *>(resource->allocate(count * sizeof(digit), alignof(digit)));
+    } else {
+      size_t log = DigitScratch::block_class(count);
+      count = size_t(1) << log;
+      DigitScratch *scratch = DigitScratch::local();
+      storage = scratch != nullptr ? scratch->take(log) : new digit[count];
+    }
+    if (size_ != 0) std::memcpy(storage, data_, size_ * sizeof(digit));
+    release();
+    data_ = storage;
+    capacity_ = count;
+    resource_ = resource;
+  }
+  void resize(size_t count, digit value = 0) {
+    if (count > capacity_) reserve(std::max(count, capacity_ + capacity_ / 2));
+    for (size_t i = size_; i < count; ++i) data_[i] = value;
+    size_ = count;
+  }
+  void push_back(digit value) {
+    if (size_ == capacity_) reserve(capacity_ * 2);
+    data_[size_++] = value;
+  }
+  void pop_back() { --size_; }
+  void clear() { size_ = 0; }
+  void assign(size_t count, digit value) {
+    clear();
+    resize(count, value);
+  }
+  void assign(const digit *first, const digit *last) {
+    auto count = static_cast<size_t>(last - first);
+    // Source may be part of this storage, so it is copied before the old storage is released
+    if (count > capacity_) {
+      DigitVector copy;
+      copy.reserve(count);
+      std::memcpy(copy.data_, first, count * sizeof(digit));
+      copy.size_ = count;
+      *this = std::move(copy);
+      return;
+    }
+    if (count != 0) std::memmove(data_, first, count * sizeof(digit));
+    size_ = count;
+  }
+
+ private:
+  void release() {
+    if (!is_inline()) {
+      if (resource_ != nullptr) {
+        resource_->deallocate(data_, capacity_ * sizeof(digit), alignof(digit));
+      } else if (DigitScratch *scratch = DigitScratch::local(); scratch != nullptr) {
+        scratch->give(data_, DigitScratch::block_class(capacity_));
+      } else {
+        delete[] data_;
+      }
+    }
+    data_ = inline_;
+    capacity_ = digit_inline_capacity;
+  }
+  void steal(DigitVector &other) {
+    if (other.is_inline()) {
+      std::memcpy(inline_, other.inline_, other.size_ * sizeof(digit));
+      data_ = inline_;
+      capacity_ = digit_inline_capacity;
+    } else {
+      data_ = other.data_;
+      capacity_ = other.capacity_;
+      resource_ = other.resource_;
+      other.data_ = other.inline_;
+      other.capacity_ = digit_inline_capacity;
+    }
+    size_ = other.size_;
+    other.size_ = 0;
+  }
+
+  digit inline_[digit_inline_capacity] = {};
+  digit *data_ = inline_;
+  size_t size_ = 0;
+  size_t capacity_ = digit_inline_capacity;
+  std::pmr::memory_resource *resource_ = nullptr;  // owner of heap storage, null for the heap
+};
+
+// Carry-propagating kernels over raw digit arrays. {result} may alias either operand, every
+// kernel returns the carry (borrow) out of the top digit
+// Portable branchless versions, overflow flags are chained without comparisons or branches
+inline digit add_n_generic(digit *result, const digit *lhs, const digit *rhs, size_t n) {
+  digit carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    digit sum;
+    digit overflow = __builtin_add_overflow(lhs[i], rhs[i], &sum);
+    overflow |= __builtin_add_overflow(sum, carry, &result[i]);
+    carry = overflow;
+  }
+  return carry;
+}
+inline digit sub_n_generic(digit *result, const digit *lhs, const digit *rhs, size_t n) {
+  digit borrow = 0;
+  for (size_t i = 0; i < n; ++i) {
+    digit diff;
+    digit overflow = __builtin_sub_overflow(lhs[i], rhs[i], &diff);
+    overflow |= __builtin_sub_overflow(diff, borrow, &result[i]);
+    borrow = overflow;
+  }
+  return borrow;
+}
+#if X86_KERNELS == 1
+// Word type of the carry intrinsics, which is long long whatever the standard
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wlong-long"
+typedef unsigned long long carry_word;
+#pragma GCC diagnostic pop
+// Single step of an add/adc (sub/sbb) chain through the carry flag
+inline unsigned char add_carry(unsigned char carry, digit lhs, digit rhs, digit *result) {
+  carry_word sum;
+  carry = _addcarry_u64(carry, lhs, rhs, &sum);
+  *result = sum;
+  return carry;
+}
+inline unsigned char sub_borrow(unsigned char borrow, digit lhs, digit rhs, digit *result) {
+  carry_word diff;
+  borrow = _subborrow_u64(borrow, lhs, rhs, &diff);
+  *result = diff;
+  return borrow;
+}
+// Carry flag chains, four digits per iteration
+inline digit add_n_adc(digit *result, const digit *lhs, const digit *rhs, size_t n) {
+  unsigned char carry = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    carry = add_carry(carry, lhs[i], rhs[i], result + i);
+    carry = add_carry(carry, lhs[i + 1], rhs[i + 1], result + i + 1);
+    carry = add_carry(carry, lhs[i + 2], rhs[i + 2], result + i + 2);
+    carry = add_carry(carry, lhs[i + 3], rhs[i + 3], result + i + 3);
+  }
+  for (; i < n; ++i) carry = add_carry(carry, lhs[i], rhs[i], result + i);
+  return carry;
+}
+inline digit sub_n_adc(digit *result, const digit *lhs, const digit *rhs, size_t n) {
+  unsigned char borrow = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    borrow = sub_borrow(borrow, lhs[i], rhs[i], result + i);
+    borrow = sub_borrow(borrow, lhs[i + 1], rhs[i + 1], result + i + 1);
+    borrow = sub_borrow(borrow, lhs[i + 2], rhs[i + 2], result + i + 2);
+    borrow = sub_borrow(borrow, lhs[i + 3], rhs[i + 3], result + i + 3);
+  }
+  for (; i < n; ++i) borrow = sub_borrow(borrow, lhs[i], rhs[i], result + i);
+  return borrow;
+}
+// Carry lookahead over a vector of lanes: {generate} has a bit per lane whose own sum overflowed,
+// {propagate} per lane that overflows once a carry comes in. Adding the shifted generate bits to
+// the propagate bits ripples every carry through its run of propagating lanes; the bits that
+// changed are the lanes receiving a carry, the bit above the top lane is the carry out
+inline unsigned lookahead_carries(unsigned generate, unsigned propagate, unsigned carry) {
+  return (((generate << 1) | carry) + propagate) ^ propagate;
+}
+// AVX-512 kernels, 8 digits per vector. Lane sums are computed independently, then the lane
+// carries are resolved at once by lookahead_carries and added back under a mask. An AVX2 version
+// of the same scheme measured no faster than the adc chains, which cover CPUs without AVX-512
+__attribute__((target("avx512f"))) inline digit add_n_avx512(digit *result, const digit *lhs,
+                                                             const digit *rhs, size_t n) {
+  const __m512i ones = _mm512_set1_epi64(-1), one = _mm512_set1_epi64(1);
+  unsigned carry = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i a = _mm512_loadu_si512(lhs + i), b = _mm512_loadu_si512(rhs + i);
+    __m512i sum = _mm512_add_epi64(a, b);
+    unsigned generate = _mm512_cmplt_epu64_mask(sum, a);
+    unsigned propagate = _mm512_cmpeq_epu64_mask(sum, ones);
+    unsigned carries = lookahead_carries(generate, propagate, carry);
+    _mm512_storeu_si512(result + i, _mm512_mask_add_epi64(sum, __mmask8(carries), sum, one));
+    carry = carries >> 8;
+  }
+  auto flag = static_cast<unsigned char>(carry);
+  for (; i < n; ++i) flag = add_carry(flag, lhs[i], rhs[i], result + i);
+  return flag;
+}
+__attribute__((target("avx512f"))) inline digit sub_n_avx512(digit *result, const digit *lhs,
+                                                             const digit *rhs, size_t n) {
+  const __m512i zero = _mm512_setzero_si512(), one = _mm512_set1_epi64(1);
+  unsigned borrow = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i a = _mm512_loadu_si512(lhs + i), b = _mm512_loadu_si512(rhs + i);
+    __m512i diff = _mm512_sub_epi64(a, b);
+    unsigned generate = _mm512_cmplt_epu64_mask(a, b);
+    unsigned propagate = _mm512_cmpeq_epu64_mask(diff, zero);
+    unsigned borrows = lookahead_carries(generate, propagate, borrow);
+    _mm512_storeu_si512(result + i, _mm512_mask_sub_epi64(diff, __mmask8(borrows), diff, one));
+    borrow = borrows >> 8;
+  }
+  auto flag = static_cast<unsigned char>(borrow);
+  for (; i < n; ++i) flag = sub_borrow(flag, lhs[i], rhs[i], result + i);
+  return flag;
+}
+#endif
+// [add_n] - result = lhs + rhs over n digits, the best kernel for the running CPU
+inline digit (*add_n)(digit *result, const digit *lhs, const digit *rhs, size_t n) = [] {
+#if X86_KERNELS == 1
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return add_n_avx512;
+  return add_n_adc;
+#else
+  return add_n_generic;
+#endif
+}();
+// [sub_n] - result = lhs - rhs over n digits, the best kernel for the running CPU
+inline digit (*sub_n)(digit *result, const digit *lhs, const digit *rhs, size_t n) = [] {
+#if X86_KERNELS == 1
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return sub_n_avx512;
+  return sub_n_adc;
+#else
+  return sub_n_generic;
+#endif
+}();
+// result = lhs + carry over n digits, stops early once the carry is absorbed
+inline digit add_1(digit *result, const digit *lhs, size_t n, digit carry) {
+  size_t i = 0;
+  for (; carry != 0 && i < n; ++i) carry = __builtin_add_overflow(lhs[i], carry, &result[i]);
+  if (result != lhs) std::copy(lhs + i, lhs + n, result + i);
+  return carry;
+}
+// result = lhs - borrow over n digits, stops early once the borrow is absorbed
+inline digit sub_1(digit *result, const digit *lhs, size_t n, digit borrow) {
+  size_t i = 0;
+  for (; borrow != 0 && i < n; ++i) borrow = __builtin_sub_overflow(lhs[i], borrow, &result[i]);
+  if (result != lhs) std::copy(lhs + i, lhs + n, result + i);
+  return borrow;
+}
+
+// Multiply kernels over raw digit arrays, every kernel returns the digit carried out of the top
+// result = lhs * multiplier over n digits, {result} may alias {lhs}
+inline digit mul_1(digit *result, const digit *lhs, size_t n, digit multiplier) {
+  digit carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    d_digit value = d_digit(lhs[i]) * multiplier + carry;
+    result[i] = static_cast<digit>(value);
+    carry = static_cast<digit>(value >> digit_size);
+  }
+  return carry;
+}
+// result += lhs * multiplier over n digits, portable version
+inline digit addmul_1_generic(digit *result, const digit *lhs, size_t n, digit multiplier) {
+  digit carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    d_digit value = d_digit(lhs[i]) * multiplier + result[i] + carry;
+    result[i] = static_cast<digit>(value);
+    carry = static_cast<digit>(value >> digit_size);
+  }
+  return carry;
+}
+// result -= lhs * multiplier over n digits, returns the borrow out of the top
+inline digit submul_1(digit *result, const digit *lhs, size_t n, digit multiplier) {
+  digit borrow = 0;
+  for (size_t i = 0; i < n; ++i) {
+    d_digit product = d_digit(lhs[i]) * multiplier + borrow;
+    auto low = static_cast<digit>(product);
+    borrow = static_cast<digit>(product >> digit_size) + (result[i] < low);
+    result[i] -= low;
+  }
+  return borrow;
+}
+#if X86_KERNELS == 1
+// result += lhs * multiplier with MULX and two independent carry chains: ADCX adds the old result
+// digits through CF, ADOX adds the high halves of the previous products through OF. Four digits
+// per iteration, the loop counter is stepped with LEA/JRCXZ that leave both flags untouched
+inline digit addmul_1_adx(digit *result, const digit *lhs, size_t n, digit multiplier) {
+  digit carry = 0;
+  if (size_t blocks = n / 4; blocks != 0) {
+    digit *out = result;
+    const digit *in = lhs;
+    digit low, high;
+    asm volatile(
+        "xor %[low], %[low]\n\t"  // clears CF and OF
+        "1:\n\t"
+        "mulx (%[in]), %[low], %[high]\n\t"
+        "adcx (%[out]), %[low]\n\t"
+        "adox %[carry], %[low]\n\t"
+        "mov %[low], (%[out])\n\t"
+        "mulx 8(%[in]), %[low], %[carry]\n\t"
+        "adcx 8(%[out]), %[low]\n\t"
+        "adox %[high], %[low]\n\t"
+        "mov %[low], 8(%[out])\n\t"
+        "mulx 16(%[in]), %[low], %[high]\n\t"
+        "adcx 16(%[out]), %[low]\n\t"
+        "adox %[carry], %[low]\n\t"
+        "mov %[low], 16(%[out])\n\t"
+        "mulx 24(%[in]), %[low], %[carry]\n\t"
+        "adcx 24(%[out]), %[low]\n\t"
+        "adox %[high], %[low]\n\t"
+        "mov %[low], 24(%[out])\n\t"
+        "lea 32(%[in]), %[in]\n\t"
+        "lea 32(%[out]), %[out]\n\t"
+        "lea -1(%[blocks]), %[blocks]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n\t"
+        "2:\n\t"
+        "mov $0, %[low]\n\t"  // folds both pending flags into the carry
+        "adcx %[low], %[carry]\n\t"
+        "adox %[low], %[carry]"
+        : [out] "+r"(out), [in] "+r"(in), [blocks] "+c"(blocks), [carry] "+&r"(carry),
+          [low] "=&r"(low), [high] "=&r"(high)
+        : "d"(multiplier)
+        : "cc", "memory");
+  }
+  for (size_t i = n & ~size_t(3); i < n; ++i) {
+    d_digit value = d_digit(lhs[i]) * multiplier + result[i] + carry;
+    result[i] = static_cast<digit>(value);
+    carry = static_cast<digit>(value >> digit_size);
+  }
+  return carry;
+}
+#endif
+// [addmul_1] - result += lhs * multiplier over n digits, the best kernel for the running CPU
+inline digit (*addmul_1)(digit *result, const digit *lhs, size_t n, digit multiplier) = [] {
+#if X86_KERNELS == 1
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("adx") && __builtin_cpu_supports("bmi2")) return addmul_1_adx;
+#endif
+  return addmul_1_generic;
+}();
+// Schoolbook product result[0, lhs_size + rhs_size) = lhs * rhs, one addmul_1 row per digit of
+// {rhs}. {result} must not overlap the operands
+inline void mul_basecase_n(digit *result, const digit *lhs, size_t lhs_size, const digit *rhs,
+                           size_t rhs_size) {
+  result[lhs_size] = mul_1(result, lhs, lhs_size, rhs[0]);
+  for (size_t i = 1; i < rhs_size; ++i)
+    result[lhs_size + i] = addmul_1(result + i, lhs, lhs_size, rhs[i]);
+}
+// Low half of a schoolbook product result[0, n) = lhs * rhs mod B^n, every row stops at digit n.
+// {result} must not overlap the operands
+inline void mul_low_n(digit *result, const digit *lhs, size_t lhs_size, const digit *rhs,
+                      size_t rhs_size, size_t n) {
+  std::fill(result, result + n, 0);
+  for (size_t i = 0; i < rhs_size && i < n; ++i) {
+    size_t length = std::min(lhs_size, n - i);
+    digit carry = addmul_1(result + i, lhs, length, rhs[i]);
+    if (i + length < n) result[i + length] = carry;
+  }
+}
+// Columns from {start} up of a schoolbook product, result[0, lhs_size + rhs_size - start) gets
+// lhs * rhs / B^start without the partial products below column {start}, which sum to less than
+// min(lhs_size, rhs_size) B^(start + 1). {result} must not overlap the operands
+inline void mul_high_n(digit *result, const digit *lhs, size_t lhs_size, const digit *rhs,
+                       size_t rhs_size, size_t start) {
+  std::fill(result, result + lhs_size + rhs_size - start, 0);
+  for (size_t i = 0; i < rhs_size; ++i) {
+    size_t skip = start > i ? start - i : 0;
+    if (skip >= lhs_size) continue;
+    digit *row = result + i + skip - start;
+    row[lhs_size - skip] = addmul_1(row, lhs + skip, lhs_size - skip, rhs[i]);
+  }
+}
+// Schoolbook square result[0, 2n) = x^2: every product x[i] * x[j] with i < j is accumulated once,
+// the sum is doubled and the squares x[i]^2 are added on the diagonal. About half the multiplies
+// of mul_basecase_n, {result} must not overlap {x}
+inline void sqr_basecase_n(digit *result, const digit *x, size_t n) {
+  result[0] = 0;
+  result[2 * n - 1] = 0;
+  if (n > 1) result[n] = mul_1(result + 1, x + 1, n - 1, x[0]);
+  for (size_t i = 1; i + 1 < n; ++i)
+    result[n + i] = addmul_1(result + 2 * i + 1, x + i + 1, n - i - 1, x[i]);
+  add_n(result, result, result, 2 * n);
+  digit carry = 0;
+  for (size_t i = 0; i < n; ++i) {
+    d_digit square = d_digit(x[i]) * x[i];
+    d_digit low = d_digit(result[2 * i]) + static_cast<digit>(square) + carry;
+    result[2 * i] = static_cast<digit>(low);
+    d_digit high = d_digit(result[2 * i + 1]) + static_cast<digit>(square >> digit_size) +
+                   static_cast<digit>(low >> digit_size);
+    result[2 * i + 1] = static_cast<digit>(high);
+    carry = static_cast<digit>(high >> digit_size);
+  }
+}
+
+// Number theoretic transform over Z/{mod}, {root} is a primitive root of {mod}. Multiplication
+// runs it for three primes and recombines the exact convolution with CRT.
+constexpr uint32_t pow_mod(uint32_t base, uint64_t exp, uint32_t mod) {
+  uint64_t result = 1, power = base;
+  for (; exp != 0; exp >>= 1) {
+    if (exp & 1) result = result * power % mod;
+    power = power * power % mod;
+  }
+  return static_cast<uint32_t>(result);
+}
+constexpr uint32_t ntt_prime1 = 2013265921;  // 15 * 2^27 + 1
+constexpr uint32_t ntt_prime2 = 469762049;   // 7 * 2^26 + 1
+constexpr uint32_t ntt_prime3 = 167772161;   // 5 * 2^25 + 1
+// [ntt_parts] - number of 32-bit NTT coefficients per digit
+constexpr size_t ntt_parts = digit_size > 32 ? digit_size / 32 : 1;
+// [ntt_max_length] - longest transform supported by all three primes
+constexpr size_t ntt_max_length = size_t(1) << 25;
+// [ntt_max_digits] - max size of the smaller operand, so that every convolution term, at most
+// {ntt_max_digits} * {ntt_parts} * (2^32)^2, stays below ntt_prime1 * ntt_prime2 * ntt_prime3
+// (~2^86.7)
+constexpr size_t ntt_max_digits = (size_t(1) << 22) / ntt_parts;
+
+template <uint32_t mod, uint32_t root>
+void ntt(std::vector<uint32_t> &values, bool invert) {
+  size_t n = values.size();
+  for (size_t i = 1, j = 0; i < n; ++i) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(values[i], values[j]);
+  }
+  std::vector<uint32_t> twiddles(n / 2);
+  for (size_t length = 2; length <= n; length <<= 1) {
+    uint32_t step = pow_mod(root, (mod - 1) / length, mod);
+    if (invert) step = pow_mod(step, mod - 2, mod);
+    size_t half = length / 2;
+    twiddles[0] = 1;
+    for (size_t i = 1; i < half; ++i)
+      twiddles[i] = static_cast<uint32_t>(uint64_t(twiddles[i - 1]) * step % mod);
+    for (size_t start = 0; start < n; start += length) {
+      uint32_t *low = values.data() + start, *high = low + half;
+      for (size_t i = 0; i < half; ++i) {
+        uint32_t u = low[i];
+        auto v = static_cast<uint32_t>(uint64_t(high[i]) * twiddles[i] % mod);
+        low[i] = u + v >= mod ? u + v - mod : u + v;
+        high[i] = u >= v ? u - v : u + mod - v;
+      }
+    }
+  }
+  if (invert) {
+    uint32_t n_inverse = pow_mod(static_cast<uint32_t>(n % mod), mod - 2, mod);
+    for (auto &value : values) value = static_cast<uint32_t>(uint64_t(value) * n_inverse % mod);
+  }
+}
+// Cyclic convolution of {lhs} and {rhs} (both of transform length) modulo {mod}
+template <uint32_t mod, uint32_t root>
+std::vector<uint32_t> ntt_convolve(std::vector<uint32_t> lhs, std::vector<uint32_t> rhs) {
+  for (auto &value : lhs) value %= mod;
+  for (auto &value : rhs) value %= mod;
+  ntt<mod, root>(lhs, false);
+  ntt<mod, root>(rhs, false);
+  for (size_t i = 0; i < lhs.size(); ++i)
+    lhs[i] = static_cast<uint32_t>(uint64_t(lhs[i]) * rhs[i] % mod);
+  ntt<mod, root>(lhs, true);
+  return lhs;
+}
+// Cyclic convolution of {values} with itself, one forward transform
+template <uint32_t mod, uint32_t root>
+std::vector<uint32_t> ntt_square(std::vector<uint32_t> values) {
+  for (auto &value : values) value %= mod;
+  ntt<mod, root>(values, false);
+  for (auto &value : values) value = static_cast<uint32_t>(uint64_t(value) * value % mod);
+  ntt<mod, root>(values, true);
+  return values;
+}
 
 class BigInteger {
   friend std::ostream &operator<<(std::ostream &lhs, const BigInteger &rhs);
@@ -39,38 +716,55 @@ class BigInteger {
   friend bool operator==(const BigInteger &lhs, const BigInteger &rhs);
   friend bool operator==(const BigInteger &lhs, digit rhs);
   friend bool operator!=(const BigInteger &lhs, const BigInteger &rhs);
+  friend std::strong_ordering operator<=>(const BigInteger &lhs, const BigInteger &rhs);
   friend BigInteger operator+(const BigInteger &lhs, const BigInteger &rhs);
-  friend BigInteger operator+(const BigInteger &lhs, const digit rhs);
-  friend BigInteger operator+(const BigInteger &lhs, const int rhs);
+  friend BigInteger operator+(BigInteger lhs, const digit rhs);
+  friend BigInteger operator+(BigInteger lhs, const int rhs);
   friend BigInteger operator*(const BigInteger &lhs, const BigInteger &rhs);
   friend BigInteger operator*(const BigInteger &lhs, const digit rhs);
   friend BigInteger operator-(const BigInteger &lhs, const BigInteger &rhs);
-  friend BigInteger operator-(const BigInteger &lhs, digit rhs);
-  friend BigInteger operator-(const BigInteger &lhs, int rhs);
+  friend BigInteger operator-(BigInteger lhs, digit rhs);
+  friend BigInteger operator-(BigInteger lhs, int rhs);
   friend BigInteger operator/(const BigInteger &lhs, const BigInteger &rhs);
   friend BigInteger operator/(const BigInteger &lhs, digit rhs);
   friend BigInteger operator%(const BigInteger &lhs, const BigInteger &rhs);
+  friend std::pair<BigInteger, BigInteger> divmod(const BigInteger &lhs, const BigInteger &rhs);
   friend BigInteger left_shift(const BigInteger &number, size_t shift);
+  friend BigInteger right_shift(const BigInteger &number, size_t shift);
+  friend BigInteger gcd(const BigInteger &lhs, const BigInteger &rhs);
+  friend BigInteger square(const BigInteger &number);
 
  public:
   bool negative;
-  std::vector<digit> digits;  // Least Significant Digit first in vector
+  DigitVector digits;  // Least Significant Digit first
 
   BigInteger() : negative(false), digits(1, 0) {}
   BigInteger(int64_t value) : negative(value < 0), digits(1, 0) {
-    if (value == std::numeric_limits<int64_t>::min()) {
-      digits[0] = 1;
-      *this = left_shift(*this, 63);
-      return;
-    }
-    value = std::abs(value);
-    digits.resize(64 / digit_size, 0);
-    for (size_t i = 0; value != 0; ++i) {
-      digits[i] = static_cast<digit>(value & static_cast<int64_t>(digit_max));
-      value >>= digit_size;
+    // Negate in unsigned arithmetic, so INT64_MIN needs no special case
+    uint64_t magnitude = static_cast<uint64_t>(value);
+    if (value < 0) magnitude = 0 - magnitude;
+    digits.resize((64 + digit_size - 1) / digit_size, 0);
+    for (size_t i = 0; magnitude != 0; ++i) {
+      digits[i] = static_cast<digit>(magnitude);
+      if constexpr (digit_size >= 64)
+        magnitude = 0;
+      else
+        magnitude >>= digit_size;
     }
     trim();
   }
+  // Build from a single unsigned digit, which may not fit into int64_t
+  static BigInteger from_digit(digit value) {
+    BigInteger result;
+    result.digits[0] = value;
+    return result;
+  }
+  static BigInteger from_double_digit(d_digit value) {
+    BigInteger result;
+    result.digits = {static_cast<digit>(value), static_cast<digit>(value >> digit_size)};
+    result.trim();
+    return result;
+  }
   explicit BigInteger(const std::string &number) : BigInteger() {
     if (number.empty()) throw std::invalid_argument("Empty string is not a valid BigInteger");
 
@@ -78,39 +772,46 @@ class BigInteger {
     if (number[0] == '-' || number[0] == '+') startPos = 1;
 
     for (size_t i = startPos; i < number.size(); ++i) {
-      char digit = number[i];
-      if (std::isdigit(digit) == 0)
+      if (std::isdigit(number[i]) == 0)
         throw std::invalid_argument("Invalid character in BigInteger string");
-
-      *this *= BigInteger(string_base);
-      *this += BigInteger(digit - '0');
     }
+    if (startPos < number.size()) *this = parse_decimal(number.data() + startPos, number.size() - startPos);
 
-    if (number[0] == '-') negative = true;
-    trim();
+    negative = number[0] == '-' && !is_zero();
   }
   BigInteger(const BigInteger &other) = default;
+  BigInteger(BigInteger &&other) noexcept = default;
   BigInteger &operator=(const BigInteger &rhs) = default;
+  BigInteger &operator=(BigInteger &&rhs) noexcept = default;
   const BigInteger &operator+() const { return *this; }
   digit to_digit() const {
     if (negative) throw std::runtime_error("Cannot convert negative number to digit");
     if (size() > 1) throw std::runtime_error("Number too large to be represented as digit");
     return digits[0];
   }
-  BigInteger operator-() const {
+  BigInteger operator-() const & {
     BigInteger result = *this;
     result.negative = !result.negative;
     return result;
   }
+  BigInteger operator-() && {
+    negative = !negative;
+    return std::move(*this);
+  }
   BigInteger &operator+=(const BigInteger &rhs) {
-    *this = *this + rhs;
+    add_signed(rhs, rhs.negative);
     return *this;
   }
   BigInteger &operator-=(const BigInteger &rhs) {
-    *this = *this - rhs;
+    add_signed(rhs, !rhs.negative);
     return *this;
   }
   BigInteger &operator*=(const BigInteger &rhs) {
+    if (rhs.size() == 1 && !is_zero() && !rhs.is_zero()) {
+      mul_add_digit(rhs[0], 0);
+      negative ^= rhs.negative;
+      return *this;
+    }
     *this = *this * rhs;
     return *this;
   }
@@ -119,9 +820,18 @@ class BigInteger {
     return *this;
   }
   BigInteger &operator%=(const BigInteger &rhs) {
-    *this = *this % rhs;
+    *this = div_rem(rhs);
     return *this;
   }
+  // Divide in place by {divisor} and return the remainder, rounding is the same as in operator/
+  // and operator%: quotient towards zero, remainder has the sign of the dividend
+  BigInteger div_rem(const BigInteger &divisor) {
+    auto [quotient, remainder] = divmod(*this, divisor);
+    *this = std::move(quotient);
+    return remainder;
+  }
+  // Divide absolute value in place by {divisor} and return the remainder of absolute values
+  digit div_rem(digit divisor) { return divide_by_single_digit(divisor); }
   // NOTE: This function assumes that the number have no leading zeros and not zero
   static size_t count_leading_zeros(digit x) {
     size_t count = 0;
@@ -131,6 +841,7 @@ class BigInteger {
     }
     return digit_size - count;
   }
+  size_t bit_length() const { return size() * digit_size - count_leading_zeros(); }
   size_t count_leading_zeros() const {
     digit x = digits.back();
     size_t count = 0;
@@ -183,22 +894,43 @@ class BigInteger {
   }
   std::string to_string() const {
     if (is_zero()) return "0";
-    auto temp = *this;
     std::string result;
-    // Calculate the estimated size and explicitly cast it to size_type
-    size_t estimatedSize =
-        static_cast<size_t>(std::ceil(static_cast<double>(size()) * (std::log10(digit_max) + 1)));
-    result.reserve(estimatedSize);  // Estimated reserve
-
-    while (temp.size() > 1 || temp[0] != 0) {
-      digit remainder = temp.divide_by_single_digit(string_base);
-      result.push_back('0' + static_cast<char>(remainder));
-    }
+    // Every digit holds a bit more than {decimal_chunk} decimal digits
+    result.reserve(size() * (decimal_chunk + 1) + 1);
     if (negative) result.push_back('-');
-
-    std::reverse(result.begin(), result.end());
+    BigInteger magnitude = *this;
+    magnitude.negative = false;
+    append_decimal(result, magnitude, 0);
     return result;
   }
+  // Append decimal representation of non-negative {number} to {out}, left padded with zeros to
+  // {width} characters. Long numbers are split by a cached power of ten and printed recursively
+  static void append_decimal(std::string &out, const BigInteger &number, size_t width) {
+    // One digit is below power_of_ten(1), splitting it by power_of_ten(0) could leave it unchanged
+    if (number.size() >= 2 && number.size() * decimal_chunk >= decimal_dc_threshold) {
+      size_t level = 0;
+      while (power_of_ten(level + 1).size() * 2 <= number.size()) ++level;
+      size_t low_width = decimal_chunk << level;
+      auto [high, low] = divmod(number, power_of_ten(level));
+      append_decimal(out, high, width > low_width ? width - low_width : 0);
+      append_decimal(out, low, low_width);
+      return;
+    }
+    // Digits of base 10^decimal_chunk, least significant first
+    std::vector<digit> chunks;
+    BigInteger rest = number;
+    while (!rest.is_zero()) chunks.push_back(rest.div_rem(decimal_chunk_base));
+    if (chunks.empty()) chunks.push_back(0);
+    std::string text = std::to_string(chunks.back());
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+      std::string chunk = std::to_string(chunks[i]);
+      text.append(decimal_chunk - chunk.size(), '0');
+      text += chunk;
+    }
+    if (text == "0" && width != 0) text.clear();
+    if (text.size() < width) out.append(width - text.size(), '0');
+    out += text;
+  }
   inline void trim() {
     while (!digits.empty() && digits.back() == 0) digits.pop_back();
     if (digits.empty()) digits.push_back(0);
@@ -220,6 +952,46 @@ class BigInteger {
       }
     }
   }
+  // this = this * multiplier + addend on absolute value, in place
+  void mul_add_digit(digit multiplier, digit addend) {
+    digit carry = mul_1(digits.data(), digits.data(), size(), multiplier);
+    carry += add_1(digits.data(), digits.data(), size(), addend);
+    if (carry != 0) digits.push_back(carry);
+    trim();
+  }
+  // 10^(decimal_chunk * 2^{level}), squares are computed once per thread and kept for reuse
+  static const BigInteger &power_of_ten(size_t level) {
+    thread_local std::deque<BigInteger> powers;
+    // The cache outlives any arena, so its digits always come from the global heap
+    DigitResourceScope heap(nullptr);
+    if (powers.empty()) powers.push_back(from_digit(decimal_chunk_base));
+    while (powers.size() <= level) powers.push_back(square_abs(powers.back()));
+    return powers[level];
+  }
+  // Parse {length} decimal characters, {decimal_chunk} characters per digit operation. Long strings
+  // are split in two, the halves are parsed recursively and joined with a cached power of ten
+  static BigInteger parse_decimal(const char *text, size_t length) {
+    // The low half takes decimal_chunk << level characters, so one chunk or less is never split
+    if (length > decimal_chunk && length >= decimal_dc_threshold) {
+      size_t level = 0;
+      while ((decimal_chunk << (level + 1)) < length) ++level;
+      size_t low_length = decimal_chunk << level;
+      BigInteger high = parse_decimal(text, length - low_length);
+      BigInteger low = parse_decimal(text + length - low_length, low_length);
+      return add_abs(high * power_of_ten(level), low);
+    }
+    BigInteger result;
+    size_t chunk = length % decimal_chunk == 0 ? decimal_chunk : length % decimal_chunk;
+    for (size_t i = 0; i < length; i += chunk, chunk = decimal_chunk) {
+      digit value = 0, multiplier = 1;
+      for (size_t j = i; j < i + chunk; ++j) {
+        value = value * 10 + static_cast<digit>(text[j] - '0');
+        multiplier *= 10;
+      }
+      result.mul_add_digit(multiplier, value);
+    }
+    return result;
+  }
   inline BigInteger &multiply_by_two() {
     digit carry = 0;
     for (size_t i = 0; i < size(); ++i) {
@@ -264,7 +1036,7 @@ class BigInteger {
     for (size_t i = 0; i < size(); ++i) {
       size_t rev_i = size() - 1 - i;  // Reverse index
       result *= static_cast<double>((d_digit)1 << digit_size);
-      result += digits[rev_i];
+      result += static_cast<double>(digits[rev_i]);
     }
 
     if (negative) result = -result;
@@ -279,113 +1051,631 @@ class BigInteger {
   }
   inline size_t size() const { return digits.size(); }
 #if SUPPORT_ISQRT == 1
-  BigInteger isqrt() const {
-    if (negative) throw std::domain_error("Square root of a negative number is not defined");
-    if (is_zero()) return BigInteger(0);
-    if (*this == BigInteger(1)) return BigInteger(1);
-
-    BigInteger left(0), right(*this + BigInteger(1)), mid;
-    while (left != right - BigInteger(1)) {
-      mid = (left + right) / (digit)2;
-      if (mid * mid <= *this) {
-        left = mid;
-      } else {
-        right = mid;
-      }
-    }
-
-    return left;
-  }
+  BigInteger isqrt() const { return sqrt_rem().first; }
 #endif
+  // {root, remainder} with root = floor(sqrt(this)) and this = root^2 + remainder
+  std::pair<BigInteger, BigInteger> sqrt_rem() const {
+    if (negative && !is_zero())
+      throw std::domain_error("Square root of a negative number is not defined");
+    return sqrt_rem_abs(*this);
+  }
+  // Floor of the {n}-th root, odd roots of negative numbers are rounded towards zero
+  BigInteger iroot(size_t n) const;
+  static std::pair<BigInteger, BigInteger> sqrt_rem_abs(const BigInteger &number);
+  static BigInteger iroot_abs(const BigInteger &number, size_t n);
   // Return lhs - rhs assuming lhs >= rhs in absolute value of both numbers
   static BigInteger sub_abs(const BigInteger &lhs, const BigInteger &rhs) {
     BigInteger result;
     result.digits.resize(lhs.size(), 0);
-    bool borrow = false;
-
-    for (size_t i = 0; i < lhs.size(); ++i) {
-      d_idigit diff = d_idigit(lhs[i]) - (i < rhs.size() ? rhs[i] : 0) - borrow;
-      borrow = false;
-      if (diff < 0) {
-        diff += ((d_idigit)1 << digit_size);
-        borrow = true;
-      }
-      result.digits[i] = static_cast<digit>(diff);
-    }
-
+    size_t n = std::min(lhs.size(), rhs.size());
+    digit borrow = sub_n(result.digits.data(), lhs.digits.data(), rhs.digits.data(), n);
+    sub_1(result.digits.data() + n, lhs.digits.data() + n, lhs.size() - n, borrow);
     return result.rlz();
   }
   static BigInteger substitute_abs(const BigInteger &lhs, const digit rhs) {
     BigInteger result;
     result.digits.resize(lhs.size(), 0);
-    bool borrow = false;
-
-    for (size_t i = 0; i < lhs.size(); ++i) {
-      d_idigit lhs_digit = lhs[i];
-      d_idigit rhs_digit =
-          (i == 0) ? rhs : 0;  // Only subtract rhs from the least significant digit
-      d_idigit sub = lhs_digit - rhs_digit - borrow;
-
-      if (lhs_digit < rhs_digit + borrow) {
-        borrow = true;
-        sub += ((d_idigit)1 << digit_size);
-      } else {
-        borrow = false;
-      }
-
-      result.digits[i] = static_cast<digit>(sub);
-    }
-
+    sub_1(result.digits.data(), lhs.digits.data(), lhs.size(), rhs);
     return result.rlz();
   }
   static BigInteger add_abs_digit(const BigInteger &lhs, const digit rhs) {
     BigInteger result;
     result.digits.resize(lhs.size(), 0);
-    digit carry = rhs;
-
-    for (size_t i = 0; i < lhs.size(); ++i) {
-      d_digit sum = (d_digit)lhs[i] + (d_digit)carry;
-      carry = sum >> digit_size;
-      result.digits[i] = sum & digit_max;
-    }
+    digit carry = add_1(result.digits.data(), lhs.digits.data(), lhs.size(), rhs);
     if (carry != 0) result.digits.push_back(carry);
-
     return result.rlz();
   }
-  inline static digit mul2(digit a, digit b, digit *carry) {
-    d_digit product = (d_digit)a * (d_digit)b;
-    *carry = product >> digit_size;
-    return product & digit_max;
+  // Compare absolute values, returns -1, 0 or 1
+  static int compare_abs(const BigInteger &lhs, const BigInteger &rhs) {
+    if (lhs.size() != rhs.size()) return lhs.size() < rhs.size() ? -1 : 1;
+    for (size_t i = lhs.size(); i-- > 0;) {
+      if (lhs[i] != rhs[i]) return lhs[i] < rhs[i] ? -1 : 1;
+    }
+    return 0;
+  }
+  // this = |this| + |rhs| in place
+  void add_abs_inplace(const BigInteger &rhs) {
+    if (size() < rhs.size()) digits.resize(rhs.size(), 0);
+    size_t n = rhs.size();
+    digit carry = add_n(digits.data(), digits.data(), rhs.digits.data(), n);
+    carry = add_1(digits.data() + n, digits.data() + n, size() - n, carry);
+    if (carry != 0) digits.push_back(carry);
   }
-  inline static digit add3(digit a, digit b, digit c, digit *carry) {
-    d_digit sum = (d_digit)a + (d_digit)b + (d_digit)c;
-    *carry = sum >> digit_size;
-    return sum & digit_max;
+  // this = |this| - |rhs| in place if {reverse} is false, else this = |rhs| - |this|. The
+  // subtrahend must not be greater than the minuend
+  void sub_abs_inplace(const BigInteger &rhs, bool reverse) {
+    if (size() < rhs.size()) digits.resize(rhs.size(), 0);
+    size_t n = rhs.size();
+    if (reverse) {
+      // |this| <= |rhs| leaves no digits of this above rhs
+      sub_n(digits.data(), rhs.digits.data(), digits.data(), n);
+    } else {
+      digit borrow = sub_n(digits.data(), digits.data(), rhs.digits.data(), n);
+      sub_1(digits.data() + n, digits.data() + n, size() - n, borrow);
+    }
+    trim();
   }
-  inline static digit add2(digit a, digit b, digit *carry) {
-    d_digit sum = (d_digit)a + (d_digit)b;
-    *carry = sum >> digit_size;
-    return sum & digit_max;
+  // this = this + (rhs_negative ? -|rhs| : |rhs|) in place
+  void add_signed(const BigInteger &rhs, bool rhs_negative) {
+    if (negative == rhs_negative) {
+      add_abs_inplace(rhs);
+    } else if (compare_abs(*this, rhs) >= 0) {
+      sub_abs_inplace(rhs, false);
+    } else {
+      sub_abs_inplace(rhs, true);
+      negative = rhs_negative;
+    }
+    if (is_zero()) negative = false;
   }
   // Add two numbers assuming they are positive
   static BigInteger add_abs(const BigInteger &lhs, const BigInteger &rhs) {
     if (lhs.size() < rhs.size()) return add_abs(rhs, lhs);
     BigInteger result;
-    size_t maxLength = std::max(lhs.size(), rhs.size() + 1);
-    result.digits.resize(maxLength + 1, 0);
+    result.digits.resize(lhs.size() + 1, 0);
+    size_t n = rhs.size();
+    digit carry = add_n(result.digits.data(), lhs.digits.data(), rhs.digits.data(), n);
+    result.digits[lhs.size()] =
+        add_1(result.digits.data() + n, lhs.digits.data() + n, lhs.size() - n, carry);
+    return result.rlz();
+  }
 
-    size_t i = 0;
-    digit carry = 0;
-    for (; i < rhs.size(); i++) result.digits[i] = add3(lhs[i], rhs[i], carry, &carry);
-    for (; i < lhs.size(); i++) result.digits[i] = add2(lhs[i], carry, &carry);
-    if (carry != 0) result.digits[i] = carry;
+  bool is_zero() const { return size() == 1 && digits[0] == 0; }
 
+  // Returns absolute value made of digits [from, to)
+  BigInteger slice(size_t from, size_t to) const {
+    BigInteger result;
+    to = std::min(to, size());
+    if (from >= to) return result;
+    result.digits.assign(digits.begin() + static_cast<std::ptrdiff_t>(from),
+                         digits.begin() + static_cast<std::ptrdiff_t>(to));
+    return result.rlz();
+  }
+  // Lowest {count} bits of the absolute value
+  BigInteger low_bits(size_t count) const {
+    BigInteger result = slice(0, (count + digit_size - 1) / digit_size);
+    if (count % digit_size != 0 && result.size() * digit_size > count)
+      result.digits.back() &= (digit(1) << (count % digit_size)) - 1;
+    result.trim();
+    return result;
+  }
+  // Schoolbook multiplication of absolute values, rows run along the longer operand
+  static BigInteger mul_basecase(const BigInteger &lhs, const BigInteger &rhs) {
+    if (lhs.size() < rhs.size()) return mul_basecase(rhs, lhs);
+    BigInteger result;
+    result.digits.resize(lhs.size() + rhs.size(), 0);
+    mul_basecase_n(result.digits.data(), lhs.digits.data(), lhs.size(), rhs.digits.data(),
+                   rhs.size());
     return result.rlz();
   }
+  // Schoolbook square of the absolute value
+  static BigInteger sqr_basecase(const BigInteger &number) {
+    BigInteger result;
+    result.digits.resize(2 * number.size(), 0);
+    sqr_basecase_n(result.digits.data(), number.digits.data(), number.size());
+    return result.rlz();
+  }
+  // Karatsuba multiplication of absolute values, splits both operands at half of the longer one
+  static BigInteger mul_karatsuba(const BigInteger &lhs, const BigInteger &rhs) {
+    if (lhs.size() < rhs.size()) return mul_karatsuba(rhs, lhs);
+    size_t half = (lhs.size() + 1) / 2;
+    BigInteger lhs_low = lhs.slice(0, half), lhs_high = lhs.slice(half, lhs.size());
+    if (rhs.size() <= half) {
+      // Unbalanced: rhs fits into one half, multiply it by both halves of lhs
+      BigInteger low = mul_abs(lhs_low, rhs), high = mul_abs(lhs_high, rhs);
+      if (!high.is_zero()) high.left_shift_digit(half);
+      return add_abs(high, low);
+    }
+    BigInteger rhs_low = rhs.slice(0, half), rhs_high = rhs.slice(half, rhs.size());
+    BigInteger z0 = mul_abs(lhs_low, rhs_low);
+    BigInteger z2 = mul_abs(lhs_high, rhs_high);
+    BigInteger z1 = mul_abs(add_abs(lhs_low, lhs_high), add_abs(rhs_low, rhs_high));
+    z1 = sub_abs(sub_abs(z1, z0), z2);
+    if (!z2.is_zero()) z2.left_shift_digit(2 * half);
+    if (!z1.is_zero()) z1.left_shift_digit(half);
+    return add_abs(add_abs(z2, z1), z0);
+  }
+  // Karatsuba square of the absolute value, the middle term comes from the square of the difference
+  // of the halves: 2 low high = low^2 + high^2 - (low - high)^2
+  static BigInteger sqr_karatsuba(const BigInteger &number) {
+    size_t half = (number.size() + 1) / 2;
+    BigInteger low = number.slice(0, half), high = number.slice(half, number.size());
+    BigInteger z0 = square_abs(low), z2 = square_abs(high);
+    bool low_larger = compare_abs(low, high) >= 0;
+    BigInteger z1 = square_abs(low_larger ? sub_abs(low, high) : sub_abs(high, low));
+    z1 = sub_abs(add_abs(z0, z2), z1);
+    if (!z2.is_zero()) z2.left_shift_digit(2 * half);
+    if (!z1.is_zero()) z1.left_shift_digit(half);
+    return add_abs(add_abs(z2, z1), z0);
+  }
+  // Divide by small non-zero {divisor} in place, the division must be exact
+  void divide_exact(int64_t divisor) {
+    divide_by_single_digit(static_cast<digit>(std::abs(divisor)));
+    if (divisor < 0) negative = !negative;
+    if (is_zero()) negative = false;
+  }
+  // Value of polynomial with coefficients {parts} (lowest first) at point {x}
+  static BigInteger evaluate(const std::vector<BigInteger> &parts, int64_t x) {
+    BigInteger result = parts.back();
+    for (size_t i = parts.size() - 1; i-- > 0;) {
+      result = result * static_cast<digit>(std::abs(x));
+      if (x < 0) result.negative = !result.negative;
+      result += parts[i];
+    }
+    return result;
+  }
+  // Toom-Cook multiplication of absolute values. Splits {lhs} into {lhs_parts} and {rhs} into
+  // {rhs_parts} blocks of equal size, so (3, 3) is Toom-3, (4, 4) is Toom-4 and (3, 2), (4, 2),
+  // (4, 3) are the unbalanced variants. Product polynomial is evaluated in 0, 1, -1, 2, -2, ...
+  // and infinity, and interpolated with Newton divided differences, all divisions are exact.
+  static BigInteger mul_toom(const BigInteger &lhs, const BigInteger &rhs, size_t lhs_parts,
+                             size_t rhs_parts) {
+    size_t block = std::max((lhs.size() + lhs_parts - 1) / lhs_parts,
+                            (rhs.size() + rhs_parts - 1) / rhs_parts);
+    std::vector<BigInteger> lhs_split, rhs_split;
+    for (size_t i = 0; i < lhs_parts; ++i) lhs_split.push_back(lhs.slice(i * block, (i + 1) * block));
+    for (size_t i = 0; i < rhs_parts; ++i) rhs_split.push_back(rhs.slice(i * block, (i + 1) * block));
+
+    // Degree of product polynomial, it is evaluated in {degree} finite points and infinity
+    std::vector<int64_t> points = toom_points(lhs_parts + rhs_parts - 2);
+    std::vector<BigInteger> values;
+    for (int64_t point : points)
+      values.push_back(evaluate(lhs_split, point) * evaluate(rhs_split, point));
+    return toom_interpolate(std::move(values), lhs_split.back() * rhs_split.back(), points, block);
+  }
+  // Toom-Cook square of the absolute value in {parts} blocks, one evaluation per point
+  static BigInteger sqr_toom(const BigInteger &number, size_t parts) {
+    size_t block = (number.size() + parts - 1) / parts;
+    std::vector<BigInteger> split;
+    for (size_t i = 0; i < parts; ++i) split.push_back(number.slice(i * block, (i + 1) * block));
+    std::vector<int64_t> points = toom_points(2 * parts - 2);
+    std::vector<BigInteger> values;
+    for (int64_t point : points) values.push_back(square_abs(evaluate(split, point)));
+    return toom_interpolate(std::move(values), square_abs(split.back()), points, block);
+  }
+  // Toom-Cook evaluation points 0, 1, -1, 2, -2, ... for a product polynomial of {degree}
+  static std::vector<int64_t> toom_points(size_t degree) {
+    std::vector<int64_t> points(degree);
+    for (size_t i = 1; i < degree; ++i) {
+      auto magnitude = static_cast<int64_t>((i + 1) / 2);
+      points[i] = (i % 2 == 1) ? magnitude : -magnitude;
+    }
+    return points;
+  }
+  // Product of Toom-Cook from its {values} in {points} and its {top} coefficient (value in
+  // infinity), coefficients are {block} digits apart
+  static BigInteger toom_interpolate(std::vector<BigInteger> values, BigInteger top,
+                                     const std::vector<int64_t> &points, size_t block) {
+    size_t degree = points.size();
+    // Values of product without its top coefficient, it leaves polynomial of degree {degree - 1}
+    for (size_t i = 0; i < degree; ++i) {
+      BigInteger top_term = top;
+      for (size_t j = 0; j < degree; ++j) top_term = top_term * static_cast<digit>(std::abs(points[i]));
+      if (points[i] < 0 && degree % 2 == 1) top_term.negative = !top_term.negative;
+      values[i] -= top_term;
+    }
+    // Newton divided differences
+    for (size_t level = 1; level < degree; ++level) {
+      for (size_t i = degree - 1; i >= level; --i) {
+        values[i] -= values[i - 1];
+        values[i].divide_exact(points[i] - points[i - level]);
+      }
+    }
+    // Newton form to coefficients: coeffs = coeffs * (x - points[i]) + values[i]
+    std::vector<BigInteger> coeffs(degree + 1);
+    coeffs[0] = values[degree - 1];
+    for (size_t i = degree - 1; i-- > 0;) {
+      for (size_t j = degree - 1 - i; j > 0; --j) {
+        BigInteger term = coeffs[j] * static_cast<digit>(std::abs(points[i]));
+        if (points[i] < 0) term.negative = !term.negative;
+        coeffs[j] = coeffs[j - 1] - term;
+      }
+      BigInteger term = coeffs[0] * static_cast<digit>(std::abs(points[i]));
+      if (points[i] < 0) term.negative = !term.negative;
+      coeffs[0] = values[i] - term;
+    }
+    coeffs[degree] = std::move(top);
+
+    BigInteger result;
+    for (size_t i = degree + 1; i-- > 0;) {
+      if (!result.is_zero()) result.left_shift_digit(block);
+      result = add_abs(result, coeffs[i]);
+    }
+    return result;
+  }
+  // NTT multiplication of absolute values: convolution of 32-bit parts of digits modulo three
+  // primes, recombined with CRT and carried back into digits
+  static BigInteger mul_ntt(const BigInteger &lhs, const BigInteger &rhs) {
+    size_t length = 1;
+    while (length < (lhs.size() + rhs.size()) * ntt_parts) length <<= 1;
+    std::vector<uint32_t> lhs_values(length, 0), rhs_values(length, 0);
+    split_ntt_parts(lhs, lhs_values);
+    split_ntt_parts(rhs, rhs_values);
+    auto r1 = ntt_convolve<ntt_prime1, 31>(lhs_values, rhs_values);
+    auto r2 = ntt_convolve<ntt_prime2, 3>(lhs_values, rhs_values);
+    auto r3 = ntt_convolve<ntt_prime3, 3>(std::move(lhs_values), std::move(rhs_values));
+    return ntt_carry(r1, r2, r3, lhs.size() + rhs.size());
+  }
+  // NTT square of the absolute value, one forward transform per prime
+  static BigInteger sqr_ntt(const BigInteger &number) {
+    size_t length = 1;
+    while (length < 2 * number.size() * ntt_parts) length <<= 1;
+    std::vector<uint32_t> values(length, 0);
+    split_ntt_parts(number, values);
+    auto r1 = ntt_square<ntt_prime1, 31>(values);
+    auto r2 = ntt_square<ntt_prime2, 3>(values);
+    auto r3 = ntt_square<ntt_prime3, 3>(std::move(values));
+    return ntt_carry(r1, r2, r3, 2 * number.size());
+  }
+  // Number of {size} digits from the convolution terms modulo the three primes
+  static BigInteger ntt_carry(const std::vector<uint32_t> &r1, const std::vector<uint32_t> &r2,
+                              const std::vector<uint32_t> &r3, size_t size) {
+    constexpr uint64_t p1p2 = uint64_t(ntt_prime1) * ntt_prime2;
+    constexpr uint64_t p1_inverse = pow_mod(ntt_prime1 % ntt_prime2, ntt_prime2 - 2, ntt_prime2);
+    constexpr uint64_t p1p2_inverse = pow_mod(p1p2 % ntt_prime3, ntt_prime3 - 2, ntt_prime3);
+    BigInteger result;
+    result.digits.resize(size, 0);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < result.size() * ntt_parts; ++i) {
+      // x = r1 + p1 * t2 + p1p2 * t3 is the exact convolution term, added to carry in 32-bit parts
+      uint64_t t2 = (r2[i] + ntt_prime2 - r1[i] % ntt_prime2) % ntt_prime2 * p1_inverse % ntt_prime2;
+      uint64_t x12 = r1[i] + ntt_prime1 * t2;
+      uint64_t t3 = (r3[i] + ntt_prime3 - x12 % ntt_prime3) % ntt_prime3 * p1p2_inverse % ntt_prime3;
+      uint64_t low_product = (p1p2 & UINT32_MAX) * t3, high_product = (p1p2 >> 32) * t3;
+      uint64_t sum = (x12 & UINT32_MAX) + (carry & UINT32_MAX) + (low_product & UINT32_MAX);
+      result.digits[i / ntt_parts] |= digit(sum & UINT32_MAX) << (i % ntt_parts * 32);
+      carry = (sum >> 32) + (x12 >> 32) + (carry >> 32) + (low_product >> 32) + high_product;
+    }
+    return result.rlz();
+  }
+  // Write digits of {number} to {values} as {ntt_parts} 32-bit coefficients each
+  static void split_ntt_parts(const BigInteger &number, std::vector<uint32_t> &values) {
+    for (size_t i = 0; i < number.size(); ++i) {
+      for (size_t part = 0; part < ntt_parts; ++part)
+        values[i * ntt_parts + part] = static_cast<uint32_t>(d_digit(number[i]) >> (part * 32));
+    }
+  }
+  // Multiply {large} by much shorter {small} chunk by chunk of {small} size
+  static BigInteger mul_unbalanced(const BigInteger &large, const BigInteger &small) {
+    BigInteger result;
+    for (size_t from = (large.size() - 1) / small.size() * small.size();; from -= small.size()) {
+      if (!result.is_zero()) result.left_shift_digit(small.size());
+      result = add_abs(result, mul_abs(large.slice(from, from + small.size()), small));
+      if (from == 0) break;
+    }
+    return result;
+  }
+  // Knuth's Algorithm D (TAOCP 4.3.1) on absolute values, {rhs} must have at least two digits and
+  // be not greater than {lhs}. Returns quotient, stores remainder to {remainder} if not null
+  static BigInteger div_knuth(const BigInteger &lhs, const BigInteger &rhs, BigInteger *remainder) {
+    constexpr d_digit base = d_digit(1) << digit_size;
+    size_t shift = rhs.count_leading_zeros();
+    BigInteger divisor = left_shift(rhs, shift), dividend = left_shift(lhs, shift);
+    size_t n = divisor.size(), m = lhs.size() - n;
+    dividend.digits.resize(lhs.size() + 1, 0);
+    const DigitVector &v = divisor.digits;
+    DigitVector &u = dividend.digits;
+
+    BigInteger quotient;
+    quotient.digits.resize(m + 1, 0);
+    for (size_t j = m + 1; j-- > 0;) {
+      // Estimate quotient digit from the top two digits, it is at most 2 too big
+      d_digit top = (d_digit(u[j + n]) << digit_size) | u[j + n - 1];
+      d_digit q_hat = top / v[n - 1], r_hat = top % v[n - 1];
+      while (q_hat >= base || q_hat * v[n - 2] > ((r_hat << digit_size) | u[j + n - 2])) {
+        --q_hat;
+        r_hat += v[n - 1];
+        if (r_hat >= base) break;
+      }
+      // Multiply and subtract q_hat * divisor from the current window
+      digit borrow = submul_1(u.data() + j, v.data(), n, static_cast<digit>(q_hat));
+      bool overshoot = u[j + n] < borrow;
+      u[j + n] -= borrow;
+      // Estimate was 1 too big, add divisor back
+      if (overshoot) {
+        --q_hat;
+        u[j + n] += add_n(u.data() + j, u.data() + j, v.data(), n);
+      }
+      quotient.digits[j] = static_cast<digit>(q_hat);
+    }
+    if (remainder != nullptr) {
+      u.resize(n);
+      dividend.negative = false;
+      dividend.trim();
+      dividend.divide_by_power_of_two(shift);
+      *remainder = dividend;
+    }
+    return quotient.rlz();
+  }
+  // Division of absolute values without size requirements, Knuth's Algorithm D for long divisors
+  static BigInteger div_basecase(const BigInteger &lhs, const BigInteger &rhs, BigInteger *remainder) {
+    if (compare_abs(lhs, rhs) < 0) {
+      if (remainder != nullptr) {
+        *remainder = lhs;
+        remainder->negative = false;
+      }
+      return BigInteger(0);
+    }
+    if (rhs.size() == 1) {
+      BigInteger quotient = lhs;
+      quotient.negative = false;
+      digit rest = quotient.divide_by_single_digit(rhs[0]);
+      if (remainder != nullptr) *remainder = from_digit(rest);
+      return quotient;
+    }
+    return div_knuth(lhs, rhs, remainder);
+  }
+  // Burnikel-Ziegler recursive division "Fast Recursive Division" (1998), algorithm 1. Divides
+  // {lhs} of at most 2n digits by normalized {rhs} of n digits, the quotient must fit in n digits
+  static BigInteger div_2n1n(const BigInteger &lhs, const BigInteger &rhs, BigInteger *remainder) {
+    size_t n = rhs.size();
+    if (n % 2 != 0 || n < std::max<size_t>(burnikel_ziegler_threshold, 1))
+      return div_basecase(lhs, rhs, remainder);
+    size_t half = n / 2;
+    BigInteger rest;
+    BigInteger high = div_3n2n(lhs.slice(half, lhs.size()), rhs, &rest);
+    if (!rest.is_zero()) rest.left_shift_digit(half);
+    BigInteger low = div_3n2n(add_abs(rest, lhs.slice(0, half)), rhs, remainder);
+    if (!high.is_zero()) high.left_shift_digit(half);
+    return add_abs(high, low);
+  }
+  // Burnikel-Ziegler algorithm 2. Divides {lhs} of at most 3 halves by normalized {rhs} of 2 halves
+  static BigInteger div_3n2n(const BigInteger &lhs, const BigInteger &rhs, BigInteger *remainder) {
+    size_t half = rhs.size() / 2;
+    BigInteger lhs_high = lhs.slice(half, lhs.size());
+    BigInteger rhs_high = rhs.slice(half, rhs.size()), rhs_low = rhs.slice(0, half);
+    BigInteger quotient, rest, subtrahend;
+    if (lhs.slice(2 * half, lhs.size()) < rhs_high) {
+      quotient = div_2n1n(lhs_high, rhs_high, &rest);
+      subtrahend = quotient * rhs_low;
+    } else {
+      // Quotient is at least base^half - 1, lhs_high - rhs_high * base^half + rhs_high
+      quotient = left_shift(BigInteger(1), half * digit_size) - 1;
+      BigInteger shifted_rhs_high = rhs_high;
+      shifted_rhs_high.left_shift_digit(half);
+      rest = lhs_high - shifted_rhs_high + rhs_high;
+      subtrahend = rhs_low;
+      if (!subtrahend.is_zero()) subtrahend.left_shift_digit(half);
+      subtrahend -= rhs_low;
+    }
+    if (!rest.is_zero()) rest.left_shift_digit(half);
+    rest += lhs.slice(0, half);
+    while (rest < subtrahend) {
+      rest += rhs;
+      quotient -= 1;
+    }
+    if (remainder != nullptr) *remainder = rest - subtrahend;
+    return quotient;
+  }
+  // Burnikel-Ziegler division of absolute values, the dividend is processed in blocks of divisor
+  // size which are divided with div_2n1n
+  static BigInteger div_burnikel_ziegler(const BigInteger &lhs, const BigInteger &rhs,
+                                         BigInteger *remainder) {
+    size_t s = rhs.size();
+    // Block size in digits n = j * m, where m is a power of two so blocks halve evenly down to the
+    // threshold, and the divisor is shifted by {sigma} bits to be exactly n normalized digits
+    size_t m = 1;
+    // Blocks of no digits cannot be divided, smaller thresholds act as 1
+    while (m <= s / std::max<size_t>(burnikel_ziegler_threshold, 1)) m <<= 1;
+    size_t n = (s + m - 1) / m * m;
+    size_t sigma = n * digit_size - rhs.bit_length();
+    BigInteger divisor = left_shift(rhs, sigma), dividend = left_shift(lhs, sigma);
+    divisor.negative = dividend.negative = false;
+
+    // Number of blocks, one more bit is needed for the first block to be less than divisor
+    size_t blocks = std::max<size_t>((dividend.bit_length() + n * digit_size) / (n * digit_size), 2);
+    BigInteger quotient, rest;
+    BigInteger window = dividend.slice((blocks - 2) * n, dividend.size());
+    for (size_t i = blocks - 2;; --i) {
+      BigInteger block_quotient = div_2n1n(window, divisor, &rest);
+      if (!block_quotient.is_zero()) block_quotient.left_shift_digit(i * n);
+      quotient = add_abs(quotient, block_quotient);
+      if (i == 0) break;
+      if (!rest.is_zero()) rest.left_shift_digit(n);
+      window = add_abs(rest, dividend.slice((i - 1) * n, i * n));
+    }
+    if (remainder != nullptr) *remainder = right_shift(rest, sigma);
+    return quotient;
+  }
+  // Divide absolute values, choosing the algorithm by operand sizes
+  static BigInteger div_abs(const BigInteger &lhs, const BigInteger &rhs, BigInteger *remainder) {
+    if (rhs.size() < burnikel_ziegler_threshold ||
+        lhs.size() < rhs.size() + burnikel_ziegler_offset)
+      return div_basecase(lhs, rhs, remainder);
+    return div_burnikel_ziegler(lhs, rhs, remainder);
+  }
+  // Multiply absolute values, choosing the algorithm by operand sizes and their ratio
+  static BigInteger mul_abs(const BigInteger &lhs, const BigInteger &rhs) {
+    const BigInteger &large = lhs.size() >= rhs.size() ? lhs : rhs;
+    const BigInteger &small = lhs.size() >= rhs.size() ? rhs : lhs;
+    size_t n = small.size();
+    // Karatsuba cannot split a single digit, smaller thresholds act as 2
+    if (n < std::max<size_t>(karatsuba_threshold, 2)) return mul_basecase(large, small);
+    if (n >= ntt_threshold && n <= ntt_max_digits &&
+        (large.size() + n) * ntt_parts <= ntt_max_length)
+      return mul_ntt(large, small);
+    if (large.size() >= 3 * n) return mul_unbalanced(large, small);
+    if (n < toom3_threshold) return mul_karatsuba(large, small);
+    if (large.size() >= 2 * n) return mul_toom(large, small, 4, 2);
+    if (2 * large.size() >= 3 * n) return mul_toom(large, small, 3, 2);
+    if (n < toom4_threshold) return mul_toom(large, small, 3, 3);
+    if (3 * large.size() >= 4 * n) return mul_toom(large, small, 4, 3);
+    return mul_toom(large, small, 4, 4);
+  }
+  // Low product |lhs * rhs| mod B^n. Above the schoolbook sizes it is Mulders' short product: the
+  // low l ~ 0.7n digits of both operands are multiplied in full, the two cross products only mod
+  // B^(n - l), and the top product is not needed at all
+  static BigInteger mul_low(const BigInteger &lhs, const BigInteger &rhs, size_t n) {
+    if (std::min(lhs.size(), rhs.size()) < std::max<size_t>(karatsuba_threshold, 2) || n < 4) {
+      BigInteger result;
+      result.digits.resize(n);
+      mul_low_n(result.digits.data(), lhs.digits.data(), std::min(lhs.size(), n),
+                rhs.digits.data(), std::min(rhs.size(), n), n);
+      result.trim();
+      return result;
+    }
+    size_t l = std::max(n - n / 2, n * 7 / 10);
+    BigInteger result = mul_abs(lhs.slice(0, l), rhs.slice(0, l)).slice(0, n);
+    BigInteger cross = add_abs(mul_low(lhs.slice(l, n), rhs.slice(0, n - l), n - l),
+                               mul_low(lhs.slice(0, n - l), rhs.slice(l, n), n - l));
+    result.add_abs_inplace(left_shift(cross, l * digit_size));
+    return result.slice(0, n);
+  }
+  // High product, floor(|lhs * rhs| / B^start) short by less than min(size) B + size: partial
+  // products at columns {start} and above are all included, those below may be left out. Above the
+  // schoolbook sizes it is Mulders' short product, the top ~0.7n digits of both operands are
+  // multiplied in full and the cross products recurse on the columns they still need
+  static BigInteger mul_high(const BigInteger &lhs, const BigInteger &rhs, size_t start) {
+    // Digits below start - (size of the other operand - 1) never reach column {start}
+    size_t skip = start + 1 > rhs.size() ? start + 1 - rhs.size() : 0;
+    if (skip >= lhs.size()) return BigInteger(0);
+    if (skip > 0) return mul_high(lhs.slice(skip, lhs.size()), rhs, start - skip);
+    skip = start + 1 > lhs.size() ? start + 1 - lhs.size() : 0;
+    if (skip > 0) return mul_high(lhs, rhs.slice(skip, rhs.size()), start - skip);
+    if (start == 0) return mul_abs(lhs, rhs);
+    size_t n = std::min(lhs.size(), rhs.size());
+    if (n < std::max<size_t>(karatsuba_threshold, 2)) {
+      BigInteger result;
+      result.digits.resize(lhs.size() + rhs.size() - start);
+      mul_high_n(result.digits.data(), lhs.digits.data(), lhs.size(), rhs.digits.data(),
+                 rhs.size(), start);
+      result.trim();
+      return result;
+    }
+    // The low l digits multiply each other only below column 2l - 1 <= start
+    size_t l = std::max<size_t>(std::min(n * 3 / 10, (start + 1) / 2), 1);
+    BigInteger top = mul_abs(lhs.slice(l, lhs.size()), rhs.slice(l, rhs.size()));
+    top = 2 * l >= start ? left_shift(top, (2 * l - start) * digit_size)
+                         : top.slice(start - 2 * l, top.size());
+    top.add_abs_inplace(mul_high(lhs.slice(l, lhs.size()), rhs.slice(0, l), start - l));
+    top.add_abs_inplace(mul_high(lhs.slice(0, l), rhs.slice(l, rhs.size()), start - l));
+    return top;
+  }
+  // Square of the absolute value, choosing the algorithm by size
+  static BigInteger square_abs(const BigInteger &number) {
+    size_t n = number.size();
+    if (n < std::max<size_t>(sqr_karatsuba_threshold, 2)) return sqr_basecase(number);
+    if (n >= sqr_ntt_threshold && n <= ntt_max_digits && 2 * n * ntt_parts <= ntt_max_length)
+      return sqr_ntt(number);
+    if (n < sqr_toom3_threshold) return sqr_karatsuba(number);
+    if (n < sqr_toom4_threshold) return sqr_toom(number, 3);
+    return sqr_toom(number, 4);
+  }
 
-  bool is_zero() const { return size() == 1 && digits[0] == 0; }
 
  private:
+  // Binary gcd of numbers of at most two digits
+  static d_digit gcd_binary(d_digit lhs, d_digit rhs) {
+    auto trailing_zeros = [](d_digit value) -> int {
+      auto low = static_cast<digit>(value);
+      return low != 0 ? std::countr_zero(low)
+                      : digit_size + std::countr_zero(static_cast<digit>(value >> digit_size));
+    };
+    if (lhs == 0) return rhs;
+    if (rhs == 0) return lhs;
+    int shift = trailing_zeros(lhs | rhs);
+    lhs >>= trailing_zeros(lhs);
+    do {
+      rhs >>= trailing_zeros(rhs);
+      if (lhs > rhs) std::swap(lhs, rhs);
+      rhs -= lhs;
+    } while (rhs != 0);
+    return lhs << shift;
+  }
+  // Bits of the absolute value from {shift} up, they must fit into a digit
+  digit bits_from(size_t shift) const {
+    size_t index = shift / digit_size, offset = shift % digit_size;
+    if (index >= size()) return 0;
+    d_digit window = digits[index];
+    if (index + 1 < size()) window |= d_digit(digits[index + 1]) << digit_size;
+    return static_cast<digit>(window >> offset);
+  }
+  // Cofactors of a Lehmer step (a, b) -> (a', b'). After an even number of Euclid steps
+  // a' = a_a * a - a_b * b and b' = b_b * b - b_a * a, after an odd one all signs flip
+  struct LehmerStep {
+    digit a_a = 1, a_b = 0, b_a = 0, b_b = 1;
+    bool odd = false;
+  };
+  // Runs Euclid on the leading bits of {a} >= {b} while the quotients are certainly the same as for
+  // the full numbers (Knuth's Algorithm L). Returns false if not even one step is certain
+  static bool lehmer_step(const BigInteger &a, const BigInteger &b, LehmerStep *step) {
+    using sdigit = std::make_signed_t<digit>;
+    // Two bits of headroom keep x + A and y + C inside sdigit
+    size_t bits = a.bit_length(), width = digit_size - 2;
+    size_t shift = bits > width ? bits - width : 0;
+    // The leading {width} bits leave the sign bit clear, so the casts keep the values
+    sdigit x = static_cast<sdigit>(a.bits_from(shift)), y = static_cast<sdigit>(b.bits_from(shift));
+    sdigit A = 1, B = 0, C = 0, D = 1;
+    bool odd = false;
+    while (y + C > 0 && y + D > 0) {
+      sdigit q = (x + A) / (y + C);
+      if (q != (x + B) / (y + D)) break;
+      sdigit t = A - q * C;
+      A = C, C = t;
+      t = B - q * D;
+      B = D, D = t;
+      t = x - q * y;
+      x = y, y = t;
+      odd = !odd;
+    }
+    if (B == 0) return false;
+    auto magnitude = [](sdigit value) { return static_cast<digit>(value < 0 ? -value : value); };
+    *step = {magnitude(A), magnitude(B), magnitude(C), magnitude(D), odd};
+    return true;
+  }
+  // |lhs| * lhs_factor - |rhs| * rhs_factor, the caller guarantees it is not negative
+  static BigInteger mul_sub_digits(const BigInteger &lhs, digit lhs_factor, const BigInteger &rhs,
+                                   digit rhs_factor) {
+    BigInteger result;
+    size_t n = std::max(lhs.size(), rhs.size()) + 1;
+    result.digits.resize(n, 0);
+    result.digits[lhs.size()] = mul_1(result.digits.data(), lhs.digits.data(), lhs.size(), lhs_factor);
+    digit borrow = submul_1(result.digits.data(), rhs.digits.data(), rhs.size(), rhs_factor);
+    sub_1(result.digits.data() + rhs.size(), result.digits.data() + rhs.size(), n - rhs.size(),
+          borrow);
+    return result.rlz();
+  }
+  static void apply_lehmer_step(BigInteger &a, BigInteger &b, const LehmerStep &step) {
+    BigInteger next_a = step.odd ? mul_sub_digits(b, step.a_b, a, step.a_a)
+                                 : mul_sub_digits(a, step.a_a, b, step.a_b);
+    b = step.odd ? mul_sub_digits(a, step.b_a, b, step.b_b) : mul_sub_digits(b, step.b_b, a, step.b_a);
+    a = std::move(next_a);
+  }
+  // Unimodular matrix of a gcd reduction, defined after the class
+  struct GcdMatrix;
+  static void gcd_step(BigInteger &a, BigInteger &b, GcdMatrix *matrix);
+  static void hgcd(BigInteger &a, BigInteger &b, GcdMatrix *matrix);
+  static void apply_inverse(BigInteger &a, BigInteger &b, GcdMatrix &matrix);
+  // Negate in place, zero stays non-negative
+  void negate() { negative = !negative && !is_zero(); }
+  // Shift right by {shift} < digit_size bits in place
+  void divide_by_power_of_two(size_t shift) {
+    if (shift == 0) return;
+    for (size_t i = 0; i < size(); ++i) {
+      digits[i] >>= shift;
+      if (i + 1 < size()) digits[i] |= digits[i + 1] << (digit_size - shift);
+    }
+    trim();
+  }
   // Returns remainder, changes the number to the quotient
   digit divide_by_single_digit(digit divisor) {
     if (divisor == 0) throw std::runtime_error("Division by zero");
@@ -442,13 +1732,107 @@ BigInteger left_shift(const BigInteger &number, const size_t shift) {
 
   return result.rlz();
 }
-inline BigInteger operator+(const BigInteger &lhs, digit rhs) {
-  if (lhs.is_zero()) return BigInteger(rhs);
+// Returns new BigInteger with digits shifted right by shift, the sign is kept
+BigInteger right_shift(const BigInteger &number, const size_t shift) {
+  BigInteger result = number.slice(shift / digit_size, number.size());
+  result.divide_by_power_of_two(shift % digit_size);
+  result.negative = number.negative && !result.is_zero();
+  return result;
+}
+// Unimodular matrix of a gcd reduction: (a, b) = M (a', b') for the reduced pair (a', b')
+struct BigInteger::GcdMatrix {
+  BigInteger m00 = 1, m01 = 0, m10 = 0, m11 = 1;
+  int det = 1;
+
+  // M = M * {rhs}
+  void multiply(const GcdMatrix &rhs) {
+    BigInteger n00 = m00 * rhs.m00 + m01 * rhs.m10, n01 = m00 * rhs.m01 + m01 * rhs.m11;
+    BigInteger n10 = m10 * rhs.m00 + m11 * rhs.m10, n11 = m10 * rhs.m01 + m11 * rhs.m11;
+    m00 = std::move(n00), m01 = std::move(n01), m10 = std::move(n10), m11 = std::move(n11);
+    det *= rhs.det;
+  }
+  // M = M * [[q, 1], [1, 0]], the matrix of one Euclid step with quotient {q}
+  void euclid(const BigInteger &q) {
+    BigInteger n00 = m00 * q + m01, n10 = m10 * q + m11;
+    m01 = std::move(m00), m11 = std::move(m10);
+    m00 = std::move(n00), m10 = std::move(n10);
+    det = -det;
+  }
+  // M = M * L^-1 for the cofactors L of a Lehmer step, L^-1 = [[b_b, a_b], [b_a, a_a]]
+  void lehmer(const LehmerStep &step) {
+    BigInteger n00 = m00 * step.b_b + m01 * step.b_a, n01 = m00 * step.a_b + m01 * step.a_a;
+    BigInteger n10 = m10 * step.b_b + m11 * step.b_a, n11 = m10 * step.a_b + m11 * step.a_a;
+    m00 = std::move(n00), m01 = std::move(n01), m10 = std::move(n10), m11 = std::move(n11);
+    if (step.odd) det = -det;
+  }
+};
+// One step of the gcd reduction of {a} >= {b} > 0: a Lehmer step if the leading bits allow it,
+// else a division. Updates {matrix} if not null
+inline void BigInteger::gcd_step(BigInteger &a, BigInteger &b, GcdMatrix *matrix) {
+  LehmerStep step;
+  if (lehmer_step(a, b, &step)) {
+    apply_lehmer_step(a, b, step);
+    if (matrix != nullptr) matrix->lehmer(step);
+    return;
+  }
+  BigInteger remainder;
+  BigInteger quotient = div_abs(a, b, &remainder);
+  a = std::move(b);
+  b = std::move(remainder);
+  if (matrix != nullptr) matrix->euclid(quotient);
+}
+// Half-gcd: reduces {a} >= {b} in place until {b} has at most half of the digits {a} had,
+// accumulating the reduction into {matrix} if not null. Above {hgcd_threshold} the matrix is
+// found recursively from the leading halves, which needs only O(M(n) log n) time
+inline void BigInteger::hgcd(BigInteger &a, BigInteger &b, GcdMatrix *matrix) {
+  size_t half = a.size() / 2;
+  if (a.size() >= hgcd_threshold) {
+    // The first call reduces the leading half of the digits, the second the leading digits of
+    // what is left, each time the matrix is applied to the full numbers
+    for (size_t pass = 0; pass < 2 && b.size() > half; ++pass) {
+      size_t from = pass == 0 ? half : 2 * half > a.size() ? 2 * half - a.size() : 0;
+      if (from == 0) break;
+      BigInteger a_top = a.slice(from, a.size()), b_top = b.slice(from, b.size());
+      GcdMatrix top;
+      hgcd(a_top, b_top, &top);
+      apply_inverse(a, b, top);
+      if (matrix != nullptr) matrix->multiply(top);
+      if (pass == 0 && b.size() > half && !b.is_zero()) gcd_step(a, b, matrix);
+    }
+  }
+  while (b.size() > half && !b.is_zero()) gcd_step(a, b, matrix);
+}
+// (a, b) = {matrix}^-1 (a, b) = det * [[m11, -m01], [-m10, m00]] (a, b). A matrix found from the
+// leading digits can overshoot in its last steps, so signs and order are restored afterwards and
+// recorded in {matrix}, which stays unimodular
+inline void BigInteger::apply_inverse(BigInteger &a, BigInteger &b, GcdMatrix &matrix) {
+  BigInteger next_a = matrix.m11 * a - matrix.m01 * b;
+  BigInteger next_b = matrix.m00 * b - matrix.m10 * a;
+  if (matrix.det < 0) next_a.negate(), next_b.negate();
+  if (next_a.negative) {
+    next_a.negate(), matrix.m00.negate(), matrix.m10.negate();
+    matrix.det = -matrix.det;
+  }
+  if (next_b.negative) {
+    next_b.negate(), matrix.m01.negate(), matrix.m11.negate();
+    matrix.det = -matrix.det;
+  }
+  if (compare_abs(next_a, next_b) < 0) {
+    std::swap(next_a, next_b);
+    std::swap(matrix.m00, matrix.m01), std::swap(matrix.m10, matrix.m11);
+    matrix.det = -matrix.det;
+  }
+  a = std::move(next_a);
+  b = std::move(next_b);
+}
+// Operators with a small rhs take lhs by value, so they do not clash with the rvalue overloads
+inline BigInteger operator+(BigInteger lhs, digit rhs) {
+  if (lhs.is_zero()) return BigInteger::from_digit(rhs);
   if (rhs == 0) return lhs;
-  if (lhs.negative) return BigInteger(rhs) - (-lhs);
+  if (lhs.negative) return BigInteger::from_digit(rhs) - (-lhs);
   return BigInteger::add_abs_digit(lhs, rhs);
 }
-inline BigInteger operator+(const BigInteger &lhs, const int rhs) {
+inline BigInteger operator+(BigInteger lhs, const int rhs) {
   if (lhs.is_zero()) return BigInteger(rhs);
   if (rhs == 0) return lhs;
   if (lhs.negative && rhs > 0) return BigInteger(rhs) - (-lhs);  // (-a) + b = b - a
@@ -457,31 +1841,38 @@ inline BigInteger operator+(const BigInteger &lhs, const int rhs) {
   return BigInteger::add_abs_digit(lhs, static_cast<digit>(rhs));
 }
 inline BigInteger operator+(const BigInteger &lhs, const BigInteger &rhs) {
-  if (lhs.is_zero()) return rhs;
-  if (rhs.is_zero()) return lhs;
-  if (lhs.negative && !rhs.negative) return rhs - (-lhs);
-  if (!lhs.negative && rhs.negative) return lhs - (-rhs);
-
-  BigInteger result = BigInteger::add_abs(ABS(lhs), ABS(rhs));
-  result.negative = lhs.negative && rhs.negative;
+  BigInteger result = lhs;
+  result += rhs;
   return result;
 }
-inline BigInteger operator-(const BigInteger &lhs, const digit rhs) {
-  if (lhs.is_zero()) return BigInteger(static_cast<int64_t>(-rhs));
+inline BigInteger operator+(BigInteger &&lhs, const BigInteger &rhs) {
+  lhs += rhs;
+  return std::move(lhs);
+}
+inline BigInteger operator+(const BigInteger &lhs, BigInteger &&rhs) {
+  rhs += lhs;
+  return std::move(rhs);
+}
+inline BigInteger operator+(BigInteger &&lhs, BigInteger &&rhs) {
+  lhs += rhs;
+  return std::move(lhs);
+}
+inline BigInteger operator-(BigInteger lhs, const digit rhs) {
+  if (lhs.is_zero()) return -BigInteger::from_digit(rhs);
   if (rhs == 0) return lhs;
   if (lhs.negative) return -((-lhs) + rhs);
   return BigInteger::substitute_abs(lhs, rhs);
 }
 inline digit operator-(const digit lhs, const BigInteger &rhs) {
-  if (rhs.is_zero()) return BigInteger(lhs).to_digit();
+  if (rhs.is_zero()) return lhs;
   if (lhs == 0) return -rhs.to_digit();
-  if (rhs.negative) return -((-rhs) + BigInteger(static_cast<int64_t>(lhs))).to_digit();
+  if (rhs.negative) return -((-rhs) + BigInteger::from_digit(lhs)).to_digit();
 
   BigInteger result = BigInteger::substitute_abs(ABS(rhs), lhs);
   result.negative = true;
   return result.rlz().to_digit();
 }
-inline BigInteger operator-(const BigInteger &lhs, const int rhs) {
+inline BigInteger operator-(BigInteger lhs, const int rhs) {
   if (lhs.is_zero()) return BigInteger(-rhs);
   if (rhs == 0) return lhs;
   if (lhs.negative && rhs > 0) return -((-lhs) + rhs);     // (-a) - b = -(a + b)
@@ -490,82 +1881,216 @@ inline BigInteger operator-(const BigInteger &lhs, const int rhs) {
   return BigInteger::substitute_abs(lhs, static_cast<digit>(rhs));
 }
 inline BigInteger operator-(const BigInteger &lhs, const BigInteger &rhs) {
-  if (lhs.is_zero()) return -rhs;
-  if (rhs.is_zero()) return lhs;
-  if (lhs == rhs) return BigInteger(0);
-
-  if (lhs.negative && rhs.negative) return (-rhs) - (-lhs);
-  if (lhs.negative && !rhs.negative) return -((-lhs) + rhs);
-  if (!lhs.negative && rhs.negative) return lhs + (-rhs);
-
-  BigInteger result;
-  result.digits.resize(std::max(lhs.size(), rhs.size()), 0);
-  if (lhs < rhs) {
-    result = BigInteger::sub_abs(rhs, lhs);
-    result.negative = true;
-  } else {
-    result = BigInteger::sub_abs(lhs, rhs);
-  }
-  return result.rlz();
+  BigInteger result = lhs;
+  result -= rhs;
+  return result;
+}
+inline BigInteger operator-(BigInteger &&lhs, const BigInteger &rhs) {
+  lhs -= rhs;
+  return std::move(lhs);
+}
+inline BigInteger operator-(const BigInteger &lhs, BigInteger &&rhs) {
+  // lhs - rhs = -(rhs - lhs)
+  rhs -= lhs;
+  if (!rhs.is_zero()) rhs.negative = !rhs.negative;
+  return std::move(rhs);
+}
+inline BigInteger operator-(BigInteger &&lhs, BigInteger &&rhs) {
+  lhs -= rhs;
+  return std::move(lhs);
 }
 inline BigInteger operator*(const BigInteger &lhs, const digit rhs) {
   if (lhs.is_zero() || rhs == 0) return 0;
-  if (lhs == 1) return BigInteger(rhs);
+  if (lhs == 1) return BigInteger::from_digit(rhs);
   if (rhs == 1) return lhs;
   if (rhs == 2) return lhs.multiply_by_two_own();
 
   BigInteger result;
   result.digits.resize(lhs.size() + 1, 0);
-
-  digit sum_carry = 0;
-  digit old_product_carry = 0;
-  for (size_t i = 0; i < lhs.size(); ++i) {
-    digit new_product_carry = 0;
-    d_digit product = BigInteger::mul2(lhs[i], rhs, &new_product_carry);
-    result.digits[i] = BigInteger::add3(static_cast<digit>(product), old_product_carry, sum_carry, &sum_carry);
-    old_product_carry = new_product_carry;
-  }
-  result.digits[lhs.size()] = old_product_carry + sum_carry;
+  result.digits[lhs.size()] = mul_1(result.digits.data(), lhs.digits.data(), lhs.size(), rhs);
   result.negative = lhs.negative;
   return result.rlz();
 }
 /* } */
 inline BigInteger operator*(const BigInteger &lhs, const BigInteger &rhs) {
+  if (&lhs == &rhs) return square(lhs);
   if (lhs.is_zero() || rhs.is_zero()) return BigInteger(0);
   if (lhs == 1) return rhs;
   if (rhs == 1) return lhs;
-  if (lhs > rhs) return rhs * lhs;
-  BigInteger result, temp;
-  result.digits.resize(lhs.size() + rhs.size(), 0);
-  for (size_t i = 0; i < lhs.size(); ++i) {
-    temp = ABS(rhs) * lhs[i];
-    temp.left_shift_digit(i);
-    result += temp;
-  }
+  BigInteger result = BigInteger::mul_abs(lhs, rhs);
   result.negative = lhs.negative ^ rhs.negative;
-  return result.rlz();
+  return result;
 }
-inline BigInteger operator^(const BigInteger &lhs, const size_t rhs) {
-  if (rhs == 0) return BigInteger(1);
-  if (rhs == 1) return lhs;
-  BigInteger result = lhs;
-  for (size_t i = 0; i < rhs - 1; ++i) {
-    result *= lhs;
+// number^2, about two thirds of the cost of a general product of the same size
+inline BigInteger square(const BigInteger &number) { return BigInteger::square_abs(number); }
+// base^exp. Factors of two of the base become one shift of the result. A one-digit odd part b is
+// packed into b^k, the largest power in one digit, and raised by squaring and multiplying by that
+// digit in linear time. Longer bases run left-to-right sliding windows over the bits of {exp} with
+// a table of their odd powers
+inline BigInteger pow(const BigInteger &base, size_t exp) {
+  if (exp == 0) return BigInteger(1);
+  if (base.is_zero() || exp == 1) return base;
+  size_t zeros = 0;
+  while (base[zeros / digit_size] == 0) zeros += digit_size;
+  zeros += static_cast<size_t>(std::countr_zero(base[zeros / digit_size]));
+  BigInteger odd = right_shift(base, zeros), result(1);
+  odd.negative = false;
+  if (odd.size() == 1) {
+    digit factor = odd[0], packed = odd[0];
+    size_t packed_exp = 1;
+    while (factor != 1 && packed <= digit_max / factor) packed *= factor, ++packed_exp;
+    size_t outer = exp / packed_exp;
+    for (size_t bit = std::bit_width(outer); bit-- > 0;) {
+      result = BigInteger::square_abs(result);
+      if ((outer >> bit) & 1) result.mul_add_digit(packed, 0);
+    }
+    digit rest = 1;
+    for (size_t i = 0; i < exp % packed_exp; ++i) rest *= factor;
+    result.mul_add_digit(rest, 0);
+  } else {
+    size_t bits = static_cast<size_t>(std::bit_width(exp));
+    size_t window = bits > 48 ? 4 : bits > 16 ? 3 : bits > 6 ? 2 : 1;
+    // odd^1, odd^3, ..., odd^(2^window - 1)
+    std::vector<BigInteger> powers(size_t(1) << (window - 1));
+    powers[0] = odd;
+    if (powers.size() > 1) {
+      BigInteger square = BigInteger::square_abs(odd);
+      for (size_t i = 1; i < powers.size(); ++i)
+        powers[i] = BigInteger::mul_abs(powers[i - 1], square);
+    }
+    bool one = true;
+    for (size_t bit = bits; bit > 0;) {
+      if (((exp >> (bit - 1)) & 1) == 0) {
+        result = BigInteger::square_abs(result);
+        --bit;
+        continue;
+      }
+      // Longest window [low, bit) of at most {window} bits that ends with a set bit
+      size_t low = bit > window ? bit - window : 0;
+      while (((exp >> low) & 1) == 0) ++low;
+      if (!one) {
+        for (size_t i = low; i < bit; ++i) result = BigInteger::square_abs(result);
+      }
+      size_t value = (exp >> low) & ((size_t(1) << (bit - low)) - 1);
+      result = one ? powers[value / 2] : BigInteger::mul_abs(result, powers[value / 2]);
+      one = false;
+      bit = low;
+    }
   }
+  if (zeros != 0) result = left_shift(result, zeros * exp);
+  result.negative = base.negative && exp % 2 == 1;
   return result;
 }
-inline BigInteger operator%(const BigInteger &lhs, const BigInteger &rhs) {
+inline BigInteger operator^(const BigInteger &lhs, const size_t rhs) { return pow(lhs, rhs); }
+// Quotient and remainder from a single division, same as {lhs / rhs, lhs % rhs}
+inline std::pair<BigInteger, BigInteger> divmod(const BigInteger &lhs, const BigInteger &rhs) {
   if (rhs.is_zero()) throw std::runtime_error("Division by zero");
-  auto quotient = lhs / rhs;
-  auto remainder = ABS(lhs) - ABS(quotient * rhs);
-  remainder.negative = lhs.negative;
-  return remainder;
+  BigInteger remainder;
+  BigInteger quotient = BigInteger::div_abs(lhs, rhs, &remainder);
+  quotient.negative = (lhs.negative ^ rhs.negative) && !quotient.is_zero();
+  remainder.negative = lhs.negative && !remainder.is_zero();
+  return {std::move(quotient), std::move(remainder)};
+}
+// Karatsuba square root (Zimmermann). The number is scaled by 4^c, c = 0 or 1, to 4k - 1 or 4k
+// bits and split into a32 | a1 | a0 of 2k, k and k bits. The root and remainder of a32 give the
+// high half s', the low half is q = (r' 2^k + a1) / 2s' and r = u 2^k + a0 - q^2 with the
+// remainder u of that division, one correction makes r non-negative. Two digits start from
+// a floating point estimate
+inline std::pair<BigInteger, BigInteger> BigInteger::sqrt_rem_abs(const BigInteger &number) {
+  size_t bits = number.bit_length();
+  if (number.is_zero() || bits <= 2 * digit_size) {
+    d_digit value = number[0];
+    if (number.size() > 1) value |= d_digit(number[1]) << digit_size;
+    auto root = static_cast<d_digit>(std::sqrt(static_cast<long double>(value)));
+    if (root != 0) root = (root + value / root) / 2;
+    root = std::min<d_digit>(root, digit_max);
+    while (root * root > value) --root;
+    while (root < digit_max && (root + 1) * (root + 1) <= value) ++root;
+    return {from_double_digit(root), from_double_digit(value - root * root)};
+  }
+  size_t quarter = (bits + 3) / 4, scale = bits + 2 <= 4 * quarter ? 1 : 0;
+  BigInteger scaled = left_shift(number, 2 * scale);
+  scaled.negative = false;
+  auto [high_root, high_rest] = sqrt_rem_abs(right_shift(scaled, 2 * quarter));
+  BigInteger middle = right_shift(scaled, quarter).low_bits(quarter);
+  auto [low_root, rest] = divmod(left_shift(high_rest, quarter) + middle, left_shift(high_root, 1));
+  BigInteger root = left_shift(high_root, quarter) + low_root;
+  BigInteger remainder = left_shift(rest, quarter) + scaled.low_bits(quarter) - square(low_root);
+  if (remainder.negative) {
+    remainder += left_shift(root, 1) - 1;
+    root -= 1;
+  }
+  if (scale != 0) {
+    // root = 2 t + s0: number = t^2 + (remainder + 2 s0 root - s0^2) / 4
+    if ((root[0] & 1) != 0) remainder += left_shift(root, 1) - 1;
+    root = right_shift(root, 1);
+    remainder = right_shift(remainder, 2);
+  }
+  return {std::move(root), std::move(remainder)};
+}
+// Newton iteration x' = ((n - 1) x + number / x^(n - 1)) / n from above. The start is one more
+// than the root of the top n * h bits, shifted by h, where h is half the bits of the root, so a
+// step or two reach the root
+inline BigInteger BigInteger::iroot_abs(const BigInteger &number, size_t n) {
+  size_t bits = number.bit_length();
+  if (bits <= n) return number.is_zero() ? BigInteger(0) : BigInteger(1);
+  size_t low = (bits + n - 1) / n / 2;
+  BigInteger top = iroot_abs(right_shift(number, n * low), n);
+  BigInteger root = left_shift(top + 1, low);
+  while (true) {
+    BigInteger next = (root * static_cast<digit>(n - 1) + number / pow(root, n - 1)) /
+                      static_cast<digit>(n);
+    if (next >= root) return root;
+    root = std::move(next);
+  }
+}
+inline BigInteger BigInteger::iroot(size_t n) const {
+  if (n == 0) throw std::domain_error("Zeroth root is not defined");
+  if (negative && !is_zero() && n % 2 == 0)
+    throw std::domain_error("Even root of a negative number is not defined");
+  if (n == 1) return *this;
+  BigInteger magnitude = *this;
+  magnitude.negative = false;
+  BigInteger root = n == 2 ? sqrt_rem_abs(magnitude).first : iroot_abs(magnitude, n);
+  root.negative = negative && !root.is_zero();
+  return root;
 }
-inline BigInteger operator<(const BigInteger lhs, digit rhs) {
+inline BigInteger operator%(const BigInteger &lhs, const BigInteger &rhs) {
+  return divmod(lhs, rhs).second;
+}
+// Greatest common divisor of absolute values: half-gcd recursion for long operands, Lehmer steps
+// for medium ones and binary gcd once both fit into two digits
+inline BigInteger gcd(const BigInteger &lhs, const BigInteger &rhs) {
+  BigInteger a = lhs, b = rhs;
+  a.negative = b.negative = false;
+  if (BigInteger::compare_abs(a, b) < 0) std::swap(a, b);
+  while (b.size() > 2) {
+    // Half-gcd needs operands of about the same size, a division step brings them there
+    if (b.size() >= hgcd_threshold && a.size() - b.size() < b.size() / 4)
+      BigInteger::hgcd(a, b, nullptr);
+    else
+      BigInteger::gcd_step(a, b, nullptr);
+  }
+  if (b.is_zero()) return a;
+  if (a.size() > 2) {
+    BigInteger remainder;
+    BigInteger::div_abs(a, b, &remainder);
+    a = std::move(remainder);
+  }
+  auto value = [](const BigInteger &number) {
+    d_digit result = number[0];
+    if (number.size() > 1) result |= d_digit(number[1]) << digit_size;
+    return result;
+  };
+  return BigInteger::from_double_digit(BigInteger::gcd_binary(value(a), value(b)));
+}
+inline bool operator<(const BigInteger &lhs, digit rhs) {
+  if (lhs.negative && !lhs.is_zero()) return true;
   if (lhs.size() > 1) return false;
   return lhs[0] < rhs;
 }
-inline BigInteger operator>(const BigInteger lhs, digit rhs) {
+inline bool operator>(const BigInteger &lhs, digit rhs) {
+  if (lhs.negative && !lhs.is_zero()) return false;
   if (lhs.size() > 1) return true;
   return lhs[0] > rhs;
 }
@@ -589,49 +2114,16 @@ BigInteger operator/(const BigInteger &lhs, digit rhs) {
 inline BigInteger operator/(const BigInteger &lhs, const BigInteger &rhs) {
   if (rhs.is_zero()) throw std::runtime_error("Division by zero");
   if (lhs.is_zero()) return BigInteger(0);
-  if (lhs == 1) return BigInteger(1);
-  if (ABS(lhs) < ABS(rhs)) return BigInteger(0);
+  if (BigInteger::compare_abs(lhs, rhs) < 0) return BigInteger(0);
   if (rhs.size() == 1) {
     BigInteger result = lhs / rhs[0];
     result.negative = lhs.negative ^ rhs.negative;
     return result;
   }
 
-  BigInteger divisor(rhs);
-  divisor.normalize();
-  divisor.negative = false;
-
-  BigInteger current_product;
-
-  auto dividend = left_shift(lhs, rhs.count_leading_zeros());
-  dividend.negative = false;
-
-  size_t shift = (dividend.size() - divisor.size()) * digit_size;
-  if (shift == 0) shift = digit_size;
-  BigInteger left_q = left_shift(BigInteger(1), shift - digit_size);
-  BigInteger right_q = left_shift(BigInteger(1), shift + digit_size);
-
-  BigInteger current_q;
-  while (left_q < right_q) {
-    current_q = (left_q + right_q) / (digit)2;
-    current_product = current_q * divisor;
-    auto diff = dividend - current_product;
-    if (diff.is_zero()) {
-      current_q.negative = lhs.negative ^ rhs.negative;
-      return current_q;
-    } else if (diff.negative) {
-      right_q = current_q;
-    } else {
-      if (diff < divisor) {
-        current_q.negative = lhs.negative ^ rhs.negative;
-        return current_q;
-      }
-      left_q = current_q + 1;
-    }
-  }
-
-  left_q.negative = lhs.negative ^ rhs.negative;
-  return left_q;
+  BigInteger result = BigInteger::div_abs(lhs, rhs, nullptr);
+  result.negative = lhs.negative ^ rhs.negative;
+  return result;
 }
 inline bool operator==(const BigInteger &lhs, const digit rhs) {
   if (lhs.size() > 1) return false;
@@ -640,9 +2132,9 @@ inline bool operator==(const BigInteger &lhs, const digit rhs) {
 }
 inline bool operator==(const BigInteger &lhs, const int rhs) {
   if (lhs.size() > 1) return false;
-  if (lhs.is_zero() && rhs == 0) return true;
-  if (lhs.negative && rhs > 0) return false;
-  return lhs[0] == static_cast<digit>(rhs);
+  if (lhs.is_zero()) return rhs == 0;
+  if (lhs.negative != (rhs < 0)) return false;
+  return lhs[0] == static_cast<digit>(rhs < 0 ? -static_cast<int64_t>(rhs) : rhs);
 }
 inline bool operator==(const BigInteger &lhs, const BigInteger &rhs) {
   if (lhs.is_zero() && rhs.is_zero()) return true;
@@ -654,26 +2146,17 @@ inline bool operator==(const BigInteger &lhs, const BigInteger &rhs) {
   return true;
 }
 inline bool operator!=(const BigInteger &lhs, const BigInteger &rhs) { return !(lhs == rhs); }
-inline bool operator<(const BigInteger &lhs, const BigInteger &rhs) {
-  return rhs > lhs && rhs != lhs;
-}
-inline bool operator>(const BigInteger &lhs, const BigInteger &rhs) {
-  if (lhs.negative && !rhs.negative) return false;
-  if (!lhs.negative && rhs.negative) return true;
-  if (lhs.negative && rhs.negative) return -lhs < -rhs;
-  if (lhs.size() != rhs.size()) return lhs.size() > rhs.size();
-
-  for (size_t i = lhs.size(); i-- > 0;) {
-    if (lhs[i] != rhs[i]) return lhs[i] > rhs[i];
-  }
-  return false;
-}
-inline bool operator<=(const BigInteger &lhs, const BigInteger &rhs) {
-  return lhs < rhs || lhs == rhs;
-}
-inline bool operator>=(const BigInteger &lhs, const BigInteger &rhs) {
-  return lhs > rhs || lhs == rhs;
+// Signs first, then one scan of the magnitudes from the top digit, no copies
+inline std::strong_ordering operator<=>(const BigInteger &lhs, const BigInteger &rhs) {
+  bool lhs_negative = lhs.negative && !lhs.is_zero(), rhs_negative = rhs.negative && !rhs.is_zero();
+  if (lhs_negative != rhs_negative) return rhs_negative <=> lhs_negative;
+  int order = BigInteger::compare_abs(lhs, rhs);
+  return lhs_negative ? 0 <=> order : order <=> 0;
 }
+inline bool operator<(const BigInteger &lhs, const BigInteger &rhs) { return (lhs <=> rhs) < 0; }
+inline bool operator>(const BigInteger &lhs, const BigInteger &rhs) { return (lhs <=> rhs) > 0; }
+inline bool operator<=(const BigInteger &lhs, const BigInteger &rhs) { return (lhs <=> rhs) <= 0; }
+inline bool operator>=(const BigInteger &lhs, const BigInteger &rhs) { return (lhs <=> rhs) >= 0; }
 
 #if SUPPORT_IFSTREAM == 1
 // this should behave exactly the same as reading int with respect to
@@ -691,6 +2174,332 @@ inline std::istream &operator>>(std::istream &lhs, BigInteger &rhs) {
   return lhs;
 }
 #endif
+
+// Left-to-right sliding window exponentiation {base}^{exp} for exp >= 1 in the ring given by
+// {square}(x) and {multiply}(x, y). Windows of up to 6 bits end with a set bit and pick one of the
+// precomputed odd powers of {base}
+template <typename Square, typename Multiply>
+BigInteger window_pow(const BigInteger &base, const BigInteger &exp, Square square,
+                      Multiply multiply) {
+  size_t bits = exp.bit_length();
+  size_t window = bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : 1;
+  auto bit = [&](size_t index) { return (exp[index / digit_size] >> (index % digit_size)) & 1; };
+  std::vector<BigInteger> powers(size_t(1) << (window - 1));
+  powers[0] = base;
+  if (powers.size() > 1) {
+    BigInteger base_square = square(base);
+    for (size_t i = 1; i < powers.size(); ++i) powers[i] = multiply(powers[i - 1], base_square);
+  }
+  BigInteger result;
+  bool one = true;
+  for (size_t high = bits; high > 0;) {
+    if (bit(high - 1) == 0) {
+      result = square(result);
+      --high;
+      continue;
+    }
+    size_t low = high > window ? high - window : 0;
+    while (bit(low) == 0) ++low;
+    size_t value = 0;
+    for (size_t i = high; i-- > low;) value = value * 2 + bit(i);
+    if (!one) {
+      for (size_t i = low; i < high; ++i) result = square(result);
+    }
+    result = one ? powers[value / 2] : multiply(result, powers[value / 2]);
+    one = false;
+    high = low;
+  }
+  return result;
+}
+
+// Montgomery arithmetic modulo an odd {modulus} of n digits, R = 2^(digit_size * n). Values are
+// kept in Montgomery form x R mod m, so a product needs no division: the reduction adds the
+// multiple of m that clears the lowest digit, n times, and drops those n zero digits
+class Montgomery {
+ public:
+  explicit Montgomery(const BigInteger &modulus)
+      : modulus_(checked(modulus)),
+        r2_(left_shift(BigInteger(1), 2 * modulus.size() * digit_size) % modulus),
+        inverse_(negated_inverse(modulus[0])) {}
+  const BigInteger &modulus() const { return modulus_; }
+
+  // value R mod m
+  BigInteger to_montgomery(const BigInteger &value) const {
+    BigInteger reduced = value % modulus_;
+    if (reduced.negative) reduced += modulus_;
+    return multiply(reduced, r2_);
+  }
+  // value / R mod m
+  BigInteger from_montgomery(const BigInteger &value) const {
+    BigInteger t = value;
+    t.digits.resize(2 * modulus_.size() + 2, 0);
+    reduce(t.digits.data());
+    return finish(t);
+  }
+  // lhs rhs / R mod m for lhs, rhs < m. Coarsely integrated operand scanning (CIOS): every digit
+  // of {lhs} adds its row lhs[i] * rhs and right after it the row u * m that clears digit i
+  BigInteger multiply(const BigInteger &lhs, const BigInteger &rhs) const {
+    size_t n = modulus_.size(), length = 2 * n + 2;
+    BigInteger t;
+    t.digits.resize(length, 0);
+    digit *out = t.digits.data();
+    for (size_t i = 0; i < n; ++i) {
+      if (i < lhs.size() && lhs[i] != 0) {
+        digit carry = addmul_1(out + i, rhs.digits.data(), rhs.size(), lhs[i]);
+        add_1(out + i + rhs.size(), out + i + rhs.size(), length - i - rhs.size(), carry);
+      }
+      digit carry = addmul_1(out + i, modulus_.digits.data(), n, out[i] * inverse_);
+      add_1(out + i + n, out + i + n, length - i - n, carry);
+    }
+    return finish(t);
+  }
+  // x^2 / R mod m for x < m, schoolbook square and a separate reduction
+  BigInteger square(const BigInteger &x) const {
+    BigInteger t;
+    t.digits.resize(2 * modulus_.size() + 2, 0);
+    sqr_basecase_n(t.digits.data(), x.digits.data(), x.size());
+    reduce(t.digits.data());
+    return finish(t);
+  }
+  // base^exp mod m of plain (not Montgomery) values, exp >= 0
+  BigInteger pow(const BigInteger &base, const BigInteger &exp) const {
+    if (exp.negative && !exp.is_zero()) throw std::domain_error("Negative exponent");
+    if (exp.is_zero()) return modulus_ == 1 ? BigInteger(0) : BigInteger(1);
+    BigInteger result = window_pow(
+        to_montgomery(base), exp, [this](const BigInteger &x) { return square(x); },
+        [this](const BigInteger &x, const BigInteger &y) { return multiply(x, y); });
+    return from_montgomery(result);
+  }
+
+ private:
+  BigInteger modulus_;
+  BigInteger r2_;  // R^2 mod m
+  digit inverse_;  // -m^-1 mod 2^digit_size
+
+  static const BigInteger &checked(const BigInteger &modulus) {
+    if (modulus.negative || modulus.is_zero() || (modulus[0] & 1) == 0)
+      throw std::invalid_argument("Montgomery modulus must be odd and positive");
+    return modulus;
+  }
+  // -m^-1 mod 2^digit_size for odd m by Newton iteration, m * m = 1 mod 8 gives the first 3 bits
+  static digit negated_inverse(digit low) {
+    digit inverse = low;
+    for (int i = 0; i < 6; ++i) inverse *= 2 - low * inverse;
+    return 0 - inverse;
+  }
+
+  // Clear the lowest n digits of {t} of 2n + 2 digits by adding multiples of m
+  void reduce(digit *t) const {
+    size_t n = modulus_.size();
+    for (size_t i = 0; i < n; ++i) {
+      digit carry = addmul_1(t + i, modulus_.digits.data(), n, t[i] * inverse_);
+      add_1(t + i + n, t + i + n, n + 2 - i, carry);
+    }
+  }
+  // Drop the n cleared digits of {t} < 2m and subtract m once if needed
+  BigInteger finish(BigInteger &t) const {
+    size_t n = modulus_.size();
+    std::copy(t.digits.begin() + n, t.digits.end(), t.digits.begin());
+    t.digits.resize(n + 2);
+    t.trim();
+    if (BigInteger::compare_abs(t, modulus_) >= 0) return BigInteger::sub_abs(t, modulus_);
+    return std::move(t);
+  }
+};
+
+// Barrett reduction by a fixed {modulus} m of k digits. mu = floor(B^2k / m) is computed once, then
+// x < B^2k (which covers x < m^2) is reduced with two truncated multiplications and at most two
+// corrections: q = floor(floor(x / B^(k - 1)) mu / B^(k + 1)) is at most 2 below floor(x / m) and
+// needs only the top columns of its product, r = x - q m only the low k + 1 digits of q m. Both are
+// short products (mul_high, mul_low) at every size
+class BarrettReducer {
+ public:
+  explicit BarrettReducer(const BigInteger &modulus)
+      : modulus_(checked(modulus)),
+        mu_(left_shift(BigInteger(1), 2 * modulus.size() * digit_size) / modulus) {}
+  const BigInteger &modulus() const { return modulus_; }
+
+  // value mod m in [0, m), also for negative values. Values of more than 2k digits fall back to
+  // division
+  BigInteger reduce(const BigInteger &value) const {
+    size_t k = modulus_.size();
+    BigInteger remainder;
+    if (value.size() > 2 * k) {
+      remainder = value % modulus_;
+      remainder.negative = false;
+    } else if (value.size() < k) {
+      remainder = value;
+      remainder.negative = false;
+    } else {
+      BigInteger quotient = high_quotient(value);
+      // x - q m < 3m fits in k + 1 digits, so both sides are taken mod B^(k + 1) and the borrow
+      // out of the subtraction is dropped
+      BigInteger product = BigInteger::mul_low(quotient, modulus_, k + 1);
+      product.digits.resize(k + 1);
+      size_t low = std::min(value.size(), k + 1);
+      remainder.digits.assign(value.digits.begin(), value.digits.begin() + low);
+      remainder.digits.resize(k + 1);
+      sub_n(remainder.digits.data(), remainder.digits.data(), product.digits.data(), k + 1);
+      remainder.trim();
+    }
+    while (BigInteger::compare_abs(remainder, modulus_) >= 0)
+      remainder.sub_abs_inplace(modulus_, false);
+    if (value.negative && !remainder.is_zero()) remainder = BigInteger::sub_abs(modulus_, remainder);
+    return remainder;
+  }
+  // Reduce every value of {values} in place
+  void reduce(std::span<BigInteger> values) const {
+    for (BigInteger &value : values) value = reduce(value);
+  }
+
+ private:
+  BigInteger modulus_;
+  BigInteger mu_;  // floor(B^2k / m)
+
+  static const BigInteger &checked(const BigInteger &modulus) {
+    if (modulus.negative || modulus.is_zero())
+      throw std::invalid_argument("Barrett modulus must be positive");
+    return modulus;
+  }
+
+  // floor(q1 mu / B^(k + 1)). The short product from column k - 2 is less than B^k below the full
+  // one, so the result is exact unless digit k of the short product is all ones and could carry
+  BigInteger high_quotient(const BigInteger &value) const {
+    size_t k = modulus_.size();
+    BigInteger top = value.slice(k - 1, value.size());
+    if (k >= 3) {
+      size_t start = k - 2;
+      BigInteger product = BigInteger::mul_high(top, mu_, start);
+      if (product.size() <= k - start || product[k - start] != ~digit(0))
+        return product.slice(k + 1 - start, product.size());
+    }
+    BigInteger product = BigInteger::mul_abs(top, mu_);
+    return product.slice(k + 1, product.size());
+  }
+};
+
+// Reduction by a modulus m = 2^k - c or m = 2^k + c with a one-digit c of at most k / 2 bits,
+// Mersenne moduli are 2^k - 1. Splitting x = hi 2^k + lo and folding to lo + c hi (or lo - c hi)
+// takes a shift and a one-digit multiply and drops k - bits(c) bits, so x < m^2 needs two folds
+// and a final subtraction, no division
+class SpecialModulusReducer {
+ public:
+  explicit SpecialModulusReducer(const BigInteger &modulus) : modulus_(modulus) {
+    if (!detect(modulus, bits_, offset_, plus_))
+      throw std::invalid_argument("Modulus is not of the form 2^k +- c with a small c");
+  }
+  // Whether {modulus} has the form 2^k +- c this reducer accepts
+  static bool is_special(const BigInteger &modulus) {
+    size_t bits;
+    digit offset;
+    bool plus;
+    return detect(modulus, bits, offset, plus);
+  }
+  const BigInteger &modulus() const { return modulus_; }
+
+  // value mod m in [0, m), also for negative values
+  BigInteger reduce(BigInteger value) const {
+    if (bits_ == 0) return BigInteger(0);
+    bool negative = value.negative;
+    value.negative = false;
+    while (value.bit_length() > bits_) fold(value);
+    // |value| < 2^k now, which is below m + c and above -m
+    if (value.negative) value.add_signed(modulus_, false);
+    if (BigInteger::compare_abs(value, modulus_) >= 0) value.sub_abs_inplace(modulus_, false);
+    if (negative && !value.is_zero()) value.sub_abs_inplace(modulus_, true);
+    return value;
+  }
+  // Reduce every value of {values} in place
+  void reduce(std::span<BigInteger> values) const {
+    for (BigInteger &value : values) value = reduce(value);
+  }
+
+ private:
+  BigInteger modulus_;
+  size_t bits_ = 0;   // k
+  digit offset_ = 0;  // c
+  bool plus_ = false;  // m = 2^k + c, else 2^k - c
+
+  // hi 2^k + lo folds to lo +- c hi, a negative value -(hi 2^k + lo) to -(lo +- c hi)
+  void fold(BigInteger &value) const {
+    size_t whole = bits_ / digit_size, part = bits_ % digit_size;
+    bool negative = value.negative;
+    BigInteger high = right_shift(value, bits_);
+    if (offset_ != 1) high.mul_add_digit(offset_, 0);
+    value.digits.resize(whole + (part != 0 ? 1 : 0));
+    if (part != 0) value.digits.back() &= (digit(1) << part) - 1;
+    value.negative = false;
+    value.trim();
+    value.add_signed(high, plus_);
+    if (negative && !value.is_zero()) value.negative = !value.negative;
+  }
+
+  static bool detect(const BigInteger &modulus, size_t &bits, digit &offset, bool &plus) {
+    if (modulus.negative || modulus.is_zero()) return false;
+    size_t length = modulus.bit_length();
+    // 2^k - c with k = bit length, else 2^k + c with k = bit length - 1
+    BigInteger below = left_shift(BigInteger(1), length) - modulus;
+    BigInteger above = modulus - left_shift(BigInteger(1), length - 1);
+    plus = BigInteger::compare_abs(above, below) < 0;
+    const BigInteger &c = plus ? above : below;
+    bits = plus ? length - 1 : length;
+    if (c.size() != 1 || 2 * c.bit_length() > bits) return false;
+    offset = c[0];
+    return true;
+  }
+};
+
+// value % reducer is value mod the reducer's modulus in [0, m), a drop-in for % by a fixed modulus
+inline BigInteger operator%(const BigInteger &value, const BarrettReducer &reducer) {
+  return reducer.reduce(value);
+}
+inline BigInteger operator%(const BigInteger &value, const SpecialModulusReducer &reducer) {
+  return reducer.reduce(value);
+}
+
+// base^exp mod {mod} for exp >= 0 and mod > 0, the result is in [0, mod). Moduli 2^k +- c with a
+// small c reduce by folding (odd ones from special_modulus_threshold digits), other odd moduli run
+// in Montgomery form. An even modulus 2^k q with odd q is split: base^exp mod q in Montgomery form,
+// base^exp mod 2^k on the low k bits, joined by CRT with q^-1 mod 2^k
+inline BigInteger powmod(const BigInteger &base, const BigInteger &exp, const BigInteger &mod) {
+  if (mod.negative || mod.is_zero()) throw std::domain_error("Modulus must be positive");
+  if (exp.negative && !exp.is_zero()) throw std::domain_error("Negative exponent");
+  bool fold = (mod[0] & 1) == 0 || mod.size() >= special_modulus_threshold;
+  if (fold && SpecialModulusReducer::is_special(mod)) {
+    SpecialModulusReducer reducer(mod);
+    if (exp.is_zero()) return reducer.reduce(BigInteger(1));
+    return window_pow(
+        reducer.reduce(base), exp, [&](const BigInteger &x) { return reducer.reduce(square(x)); },
+        [&](const BigInteger &x, const BigInteger &y) { return reducer.reduce(x * y); });
+  }
+  if ((mod[0] & 1) != 0) return Montgomery(mod).pow(base, exp);
+  size_t zeros = 0;
+  while (mod[zeros / digit_size] == 0) zeros += digit_size;
+  zeros += static_cast<size_t>(std::countr_zero(mod[zeros / digit_size]));
+  BigInteger odd = right_shift(mod, zeros);
+  BigInteger odd_part = odd == 1 ? BigInteger(0) : Montgomery(odd).pow(base, exp);
+  BigInteger power_part(exp.is_zero() ? 1 : 0);
+  if (!exp.is_zero()) {
+    BigInteger low = base.low_bits(zeros);
+    if (base.negative && !low.is_zero()) low = left_shift(BigInteger(1), zeros) - low;
+    power_part = window_pow(
+        low, exp, [zeros](const BigInteger &x) { return square(x).low_bits(zeros); },
+        [zeros](const BigInteger &x, const BigInteger &y) { return (x * y).low_bits(zeros); });
+  }
+  if (odd == 1) return power_part;
+  // q^-1 mod 2^k by Newton iteration, each step doubles the correct low bits
+  BigInteger inverse(1);
+  for (size_t bits = 1; bits < zeros;) {
+    bits = std::min(2 * bits, zeros);
+    BigInteger correction = BigInteger(2) - (odd * inverse).low_bits(bits);
+    correction = correction.negative ? left_shift(BigInteger(1), bits) + correction : correction;
+    inverse = (inverse * correction).low_bits(bits);
+  }
+  // x = odd_part + q h with h = (power_part - odd_part) q^-1 mod 2^k
+  BigInteger difference = power_part - odd_part.low_bits(zeros);
+  if (difference.negative) difference += left_shift(BigInteger(1), zeros);
+  return odd_part + odd * (difference * inverse).low_bits(zeros);
+}
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 class BigRational {
  public:
@@ -702,7 +2511,7 @@ class BigRational {
   BigRational(int64_t a, int64_t b)
       : numerator(ABS(a)), denominator(ABS(b)), negative((a < 0) ^ (b < 0)) {
     if (denominator.is_zero()) throw std::runtime_error("Denominator cannot be zero");
-    *this = to_normalized();
+    normalize();
   }
   BigRational(const std::string &a, const std::string &b) {
     BigInteger a_BigInt(a), b_BigInt(b);
@@ -710,24 +2519,38 @@ class BigRational {
     numerator = ABS(a_BigInt);
     denominator = ABS(b_BigInt);
     if (denominator.is_zero()) throw std::runtime_error("Denominator cannot be zero");
-    *this = to_normalized();
+    normalize();
   }
   BigRational(const BigRational &other) = default;
+  BigRational(BigRational &&other) noexcept = default;
   BigRational &operator=(const BigRational &rhs) = default;
+  BigRational &operator=(BigRational &&rhs) noexcept = default;
   const BigRational &operator+() const { return *this; }
   BigRational operator-() const {
     BigRational result = *this;
-    result.negative = !result.negative;
-    return result.to_normalized();
+    result.negative = !result.negative && !result.is_zero();
+    return result;
   }
   // binary arithmetics operators
   BigRational &operator+=(const BigRational &rhs) {
-    *this = *this + rhs;
+    add_signed(rhs, rhs.negative);
+    return *this;
+  }
+  BigRational &operator-=(const BigRational &rhs) {
+    add_signed(rhs, !rhs.negative);
+    return *this;
+  }
+  BigRational &operator*=(const BigRational &rhs) {
+    if (&rhs == this) return *this *= BigRational(rhs);
+    multiply_by(rhs.numerator, rhs.denominator, rhs.negative, split_with(rhs));
+    return *this;
+  }
+  BigRational &operator/=(const BigRational &rhs) {
+    if (rhs.numerator.is_zero()) throw std::runtime_error("Division by zero");
+    if (&rhs == this) return *this /= BigRational(rhs);
+    multiply_by(rhs.denominator, rhs.numerator, rhs.negative, split_with(rhs));
     return *this;
   }
-  BigRational &operator-=(const BigRational &rhs);
-  BigRational &operator*=(const BigRational &rhs);
-  BigRational &operator/=(const BigRational &rhs);
 
   friend BigRational operator+(BigRational lhs, const BigRational &rhs);
   friend BigRational operator-(BigRational lhs, const BigRational &rhs);
@@ -736,146 +2559,217 @@ class BigRational {
 
   double sqrt() const;
   bool isZero() const { return numerator.is_zero(); }
-  // Find greatest common divisor
-  static BigInteger gcd(const BigInteger &a, const BigInteger &b) {
-    BigInteger x = a;
-    BigInteger y = b;
-    while (!y.is_zero()) {
-      BigInteger temp = y;
-      y = x % y;
-      x = temp;
-    }
-    return x;
-  }
+  // Find greatest common divisor of absolute values
+  static BigInteger gcd(const BigInteger &a, const BigInteger &b) { return ::gcd(a, b); }
 
   inline BigRational to_normalized() const {
     BigRational result = *this;
+    result.normalize();
+    return result;
+  }
+  // Reduce numerator and denominator by their gcd in place, a no-op for known reduced values
+  BigRational &normalize() {
     if (denominator.is_zero()) throw std::runtime_error("Denominator cannot be zero");
+    if (reduced) return *this;
     if (numerator.is_zero()) {
-      result.numerator = BigInteger(0);
-      result.denominator = BigInteger(1);
-      return result;
-    }
-    BigInteger gcdValue = gcd(result.numerator, result.denominator);
-    result.numerator /= gcdValue;
-    result.denominator /= gcdValue;
-    if (result.denominator < BigInteger(0)) {
-      // Ensure the denominator is positive
-      result.denominator = -result.denominator;
-      result.numerator = -result.numerator;
+      numerator = BigInteger(0);
+      denominator = BigInteger(1);
+      negative = false;
+    } else {
+      BigInteger gcdValue = gcd(numerator, denominator);
+      if (gcdValue != 1) {
+        numerator /= gcdValue;
+        denominator /= gcdValue;
+      }
     }
-
-    return result;
+    reduced = true;
+    return *this;
   }
+  // Numerator and denominator are known to be coprime. Set by normalize() and the constructors,
+  // kept by sign changes and cleared by arithmetic; a default-constructed value starts unreduced so
+  // its fields can be assigned directly
+  bool is_reduced() const { return reduced; }
 
   bool is_zero() const { return numerator.is_zero(); }
 
   BigRational add_abs(const BigRational &lhs, const BigRational &rhs) const {
-    BigRational result;
-    result.denominator = lhs.denominator * rhs.denominator;
-    result.numerator = lhs.numerator * rhs.denominator + rhs.numerator * lhs.denominator;
-    return result.to_normalized();
+    BigRational result = lhs;
+    result.negative = false;
+    result.add_signed(rhs, false);
+    return result;
   }
 
   friend bool operator<(const BigRational &lhs, const BigRational &rhs);
+  friend std::strong_ordering operator<=>(const BigRational &lhs, const BigRational &rhs);
 #if SUPPORT_ISQRT == 1
   BigInteger isqrt() const;
 #endif
  private:
   // here you can add private data and members, but do not add stuff to
   // public interface, also you can declare friends here if you want
+  bool reduced = false;
+
+  size_t digits() const { return numerator.size() + denominator.size(); }
+
+  // Fix up a fresh arithmetic result: magnitudes in numerator and denominator, sign in negative,
+  // zero non-negative. Reduced right away only above rational_reduce_threshold digits
+  void settle(bool known_reduced = false) {
+    negative ^= numerator.negative;
+    numerator.negative = false;
+    if (numerator.is_zero()) negative = false;
+    reduced = known_reduced && !numerator.is_zero();
+    if (!reduced && digits() >= rational_reduce_threshold) normalize();
+  }
+  // Reduced operands whose result is due for reduction are combined through the gcds of their
+  // parts (Knuth 4.5.1), so products are formed from smaller numbers and come out reduced
+  bool split_with(const BigRational &rhs) const {
+    return reduced && rhs.reduced && digits() + rhs.digits() >= rational_reduce_threshold;
+  }
+  // this += |rhs| with the sign {rhs_negative}
+  void add_signed(const BigRational &rhs, bool rhs_negative) {
+    if (&rhs == this) return add_signed(BigRational(rhs), rhs_negative);
+    if (rhs.is_zero()) return;
+    if (is_zero()) {
+      *this = rhs;
+      negative = rhs_negative;
+      return;
+    }
+    bool subtract = negative != rhs_negative;
+    bool split = split_with(rhs);
+    // a/b + c/d with g = gcd(b, d): t = a (d / g) + c (b / g), result is t / g2 over
+    // (b / g) (d / g2) with g2 = gcd(t, g)
+    BigInteger common = split ? gcd(denominator, rhs.denominator) : BigInteger(1);
+    if (common == 1) {
+      BigInteger cross = rhs.numerator * denominator;
+      numerator *= rhs.denominator;
+      numerator.add_signed(cross, subtract);
+      denominator *= rhs.denominator;
+      return settle(split);
+    }
+    denominator /= common;
+    BigInteger cross = rhs.numerator * denominator;
+    numerator *= rhs.denominator / common;
+    numerator.add_signed(cross, subtract);
+    BigInteger rest = gcd(numerator, common);
+    if (rest != 1) {
+      numerator /= rest;
+      denominator *= rhs.denominator / rest;
+    } else {
+      denominator *= rhs.denominator;
+    }
+    settle(true);
+  }
+  // this *= {rhs_numerator} / {rhs_denominator} with the sign {rhs_negative}, a/b * c/d divides
+  // out gcd(a, d) and gcd(c, b) first when {split}
+  void multiply_by(const BigInteger &rhs_numerator, const BigInteger &rhs_denominator,
+                   bool rhs_negative, bool split) {
+    negative ^= rhs_negative;
+    if (is_zero()) return settle();
+    if (!split) {
+      numerator *= rhs_numerator;
+      denominator *= rhs_denominator;
+      return settle();
+    }
+    BigInteger lhs_common = gcd(numerator, rhs_denominator);
+    BigInteger rhs_common = gcd(rhs_numerator, denominator);
+    if (lhs_common != 1) numerator /= lhs_common;
+    if (rhs_common != 1) denominator /= rhs_common;
+    if (rhs_common != 1) {
+      numerator *= rhs_numerator / rhs_common;
+    } else {
+      numerator *= rhs_numerator;
+    }
+    if (lhs_common != 1) {
+      denominator *= rhs_denominator / lhs_common;
+    } else {
+      denominator *= rhs_denominator;
+    }
+    settle(true);
+  }
 };
 inline BigRational operator+(BigRational lhs, const BigRational &rhs) {
-  if (lhs.numerator.is_zero()) {
-    return rhs;
-  } else if (rhs.numerator.is_zero()) {
-    return lhs;
-  }
-  if (lhs.negative && !rhs.negative) {  // -a + b = b - a
-    return rhs - (-lhs);
-  } else if (!lhs.negative && rhs.negative) {  // a + (-b) = a - b
-    return lhs - (-rhs);
-  } else {  // a + b or -a + (-b)
-    BigRational temp = rhs, temp2 = lhs;
-    temp.negative = false;
-    temp2.negative = false;
-    BigRational result = lhs.add_abs(temp2, temp);
-    result.negative = lhs.negative && rhs.negative;
-    return result.to_normalized();
-  }
+  lhs += rhs;
+  return lhs;
 };
 inline BigRational operator-(BigRational lhs, const BigRational &rhs) {
-  if (lhs.numerator.is_zero()) {
-    BigRational result = rhs;
-    result.negative = !result.negative;
-    return result.to_normalized();
-  }
-  if (rhs.numerator.is_zero()) return lhs;
-
-  BigRational result;
-  result.denominator = lhs.denominator * rhs.denominator;
-  result.numerator = lhs.numerator * rhs.denominator - rhs.numerator * lhs.denominator;
-  result.negative = lhs.negative ^ rhs.negative;
-  return result.to_normalized();
+  lhs -= rhs;
+  return lhs;
 };
 inline BigRational operator*(BigRational lhs, const BigRational &rhs) {
-  BigRational result;
-  result.numerator = lhs.numerator * rhs.numerator;
-  result.denominator = lhs.denominator * rhs.denominator;
-  result.negative = lhs.negative ^ rhs.negative;
-  return result.to_normalized();
+  lhs *= rhs;
+  return lhs;
 };
-inline BigRational operator/(const BigRational lhs, const BigRational &rhs) {
-  if (rhs.numerator.is_zero()) throw std::runtime_error("Division by zero");
-  BigRational result;
-  result.numerator = lhs.numerator * rhs.denominator;
-  result.denominator = lhs.denominator * rhs.numerator;
-  result.negative = lhs.negative ^ rhs.negative;
-  return result.to_normalized();
+inline BigRational operator/(BigRational lhs, const BigRational &rhs) {
+  lhs /= rhs;
+  return lhs;
 };
+// Comparisons need no gcd, unreduced values are compared as they are. a/b against c/d is mostly
+// decided by signs and bit lengths, 2^(|a| - |b| - 1) < a/b < 2^(|a| - |b| + 1), only close values
+// cross-multiply
+inline std::strong_ordering operator<=>(const BigRational &lhs, const BigRational &rhs) {
+  int lhs_sign = lhs.isZero() ? 0 : lhs.negative ? -1 : 1;
+  int rhs_sign = rhs.isZero() ? 0 : rhs.negative ? -1 : 1;
+  if (lhs_sign != rhs_sign || lhs_sign == 0) return lhs_sign <=> rhs_sign;
+  auto log2 = [](const BigRational &value) {
+    return static_cast<ptrdiff_t>(value.numerator.bit_length()) -
+           static_cast<ptrdiff_t>(value.denominator.bit_length());
+  };
+  auto order = [&]() -> std::strong_ordering {
+    ptrdiff_t lhs_log = log2(lhs), rhs_log = log2(rhs);
+    if (lhs_log > rhs_log + 1) return std::strong_ordering::greater;
+    if (lhs_log + 1 < rhs_log) return std::strong_ordering::less;
+    if (lhs.denominator == rhs.denominator)
+      return BigInteger::compare_abs(lhs.numerator, rhs.numerator) <=> 0;
+    return BigInteger::compare_abs(lhs.numerator * rhs.denominator,
+                                   rhs.numerator * lhs.denominator) <=> 0;
+  }();
+  return lhs_sign < 0 ? 0 <=> order : order;
+}
 inline bool operator==(const BigRational &lhs, const BigRational &rhs) {
-  auto lhs_norm = lhs.to_normalized();
-  auto rhs_norm = rhs.to_normalized();
-  if (lhs_norm.isZero() && rhs_norm.isZero()) return true;
-  if (lhs_norm.negative != rhs_norm.negative) return false;
-  if (lhs_norm.numerator != rhs_norm.numerator) return false;
-  if (lhs_norm.denominator != rhs_norm.denominator) return false;
-  return true;
+  if (lhs.isZero() || rhs.isZero()) return lhs.isZero() && rhs.isZero();
+  if (lhs.negative != rhs.negative) return false;
+  if (lhs.is_reduced() && rhs.is_reduced())
+    return lhs.numerator == rhs.numerator && lhs.denominator == rhs.denominator;
+  return (lhs <=> rhs) == 0;
 }
 inline bool operator!=(const BigRational &lhs, const BigRational &rhs) { return !(lhs == rhs); };
-inline bool operator<(const BigRational &lhs, const BigRational &rhs) {
-  if (lhs.negative && !rhs.negative) return true;
-  if (!lhs.negative && rhs.negative) return false;
-
-  auto lhs_norm = lhs.to_normalized();
-  auto rhs_norm = rhs.to_normalized();
-  if (lhs.negative && rhs.negative) {
-    return lhs_norm.numerator * rhs_norm.denominator > rhs_norm.numerator * lhs_norm.denominator;
-  } else {
-    return lhs_norm.numerator * rhs_norm.denominator < rhs_norm.numerator * lhs_norm.denominator;
-  }
-}
-inline bool operator>(const BigRational &lhs, const BigRational &rhs) {
-  if (lhs.negative && !rhs.negative) return false;
-  if (!lhs.negative && rhs.negative) return true;
-
-  auto lhs_norm = lhs.to_normalized();
-  auto rhs_norm = rhs.to_normalized();
-  if (lhs.negative && rhs.negative) {
-    return lhs_norm.numerator * rhs_norm.denominator < rhs_norm.numerator * lhs_norm.denominator;
-  } else {
-    return lhs_norm.numerator * rhs_norm.denominator > rhs_norm.numerator * lhs_norm.denominator;
-  }
-}
+inline bool operator<(const BigRational &lhs, const BigRational &rhs) { return (lhs <=> rhs) < 0; }
+inline bool operator>(const BigRational &lhs, const BigRational &rhs) { return (lhs <=> rhs) > 0; }
 inline bool operator<=(const BigRational &lhs, const BigRational &rhs) {
-  return lhs < rhs || lhs == rhs;
+  return (lhs <=> rhs) <= 0;
 }
 inline bool operator>=(const BigRational &lhs, const BigRational &rhs) {
-  return lhs > rhs || lhs == rhs;
+  return (lhs <=> rhs) >= 0;
+}
+
+#if SUPPORT_ISQRT == 1
+// floor(sqrt(p / q)) = floor(sqrt(floor(p / q)))
+inline BigInteger BigRational::isqrt() const {
+  if (negative && !is_zero())
+    throw std::domain_error("Square root of a negative number is not defined");
+  return (numerator / denominator).isqrt();
+}
+#endif
+// The value is scaled by 4^scale to 103-105 bits, its integer square root of 52-53 bits converts to
+// double exactly and is scaled back by 2^-scale
+inline double BigRational::sqrt() const {
+  if (negative && !is_zero())
+    throw std::domain_error("Square root of a negative number is not real");
+  if (is_zero()) return 0.0;
+  auto log2 = static_cast<ptrdiff_t>(numerator.bit_length()) -
+              static_cast<ptrdiff_t>(denominator.bit_length());
+  ptrdiff_t scale = (104 - log2) / 2;
+  BigInteger scaled = scale >= 0
+                          ? left_shift(numerator, static_cast<size_t>(2 * scale)) / denominator
+                          : numerator / left_shift(denominator, static_cast<size_t>(-2 * scale));
+  return std::ldexp(static_cast<double>(BigInteger::sqrt_rem_abs(scaled).first),
+                    static_cast<int>(-scale));
 }
 
 inline std::ostream &operator<<(std::ostream &lhs, const BigRational &rhs) {
-  lhs << rhs.numerator.to_string() << "/" << rhs.denominator.to_string();
+  BigRational reduced = rhs.to_normalized();
+  if (reduced.negative) lhs << '-';
+  lhs << reduced.numerator.to_string() << "/" << reduced.denominator.to_string();
   return lhs;
 }
 
@@ -0,0 +1,452 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/lib.cpp"
+
+// NOTE: Benchmarks are plain executables, run them with `make bench` on an optimized build.
+
+using bench_clock = std::chrono::steady_clock;
+
+BigInteger random_big(std::mt19937_64 &rng, size_t size) {
+  BigInteger result;
+  result.digits.resize(size);
+  for (auto &d : result.digits) d = static_cast<digit>(rng());
+  if (result.digits.back() == 0) result.digits.back() = 1;
+  return result;
+}
+
+// Average time of {fn} in microseconds, repeats until at least ~50ms were spent
+template <typename Fn>
+double time_us(Fn &&fn) {
+  size_t runs = 0;
+  auto start = bench_clock::now();
+  auto elapsed = bench_clock::duration::zero();
+  do {
+    fn();
+    ++runs;
+    elapsed = bench_clock::now() - start;
+  } while (elapsed < std::chrono::milliseconds(50));
+  return std::chrono::duration<double, std::micro>(elapsed).count() / static_cast<double>(runs);
+}
+
+// Crossover between multiplication algorithms, square products of {size} digits. Every column
+// runs one level of its algorithm, lower levels use the default dispatch.
+void bench_mul_crossover() {
+  std::printf("== multiplication crossover (us per product) ==\n");
+  std::printf("%8s %12s %12s %12s %12s %12s\n", "digits", "basecase", "karatsuba", "toom3", "toom4",
+              "ntt");
+  std::mt19937_64 rng(42);
+  for (size_t size : {16, 32, 64, 96, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768}) {
+    BigInteger a = random_big(rng, size), b = random_big(rng, size);
+    // Schoolbook is skipped where it would only slow the run down
+    double basecase = size <= 4096 ? time_us([&] { return BigInteger::mul_basecase(a, b); }) : 0;
+    double karatsuba = time_us([&] { return BigInteger::mul_karatsuba(a, b); });
+    double toom3 = time_us([&] { return BigInteger::mul_toom(a, b, 3, 3); });
+    double toom4 = time_us([&] { return BigInteger::mul_toom(a, b, 4, 4); });
+    double ntt = time_us([&] { return BigInteger::mul_ntt(a, b); });
+    std::printf("%8zu %12.2f %12.2f %12.2f %12.2f %12.2f\n", size, basecase, karatsuba, toom3, toom4,
+                ntt);
+  }
+}
+
+// Same for squaring, with the general product (default dispatch) for reference
+void bench_sqr_crossover() {
+  std::printf("== squaring crossover (us per square) ==\n");
+  std::printf("%8s %12s %12s %12s %12s %12s %12s\n", "digits", "basecase", "karatsuba", "toom3",
+              "toom4", "ntt", "product");
+  std::mt19937_64 rng(50);
+  for (size_t size : {16, 32, 64, 96, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768}) {
+    BigInteger a = random_big(rng, size), b = a;
+    double basecase = size <= 4096 ? time_us([&] { return BigInteger::sqr_basecase(a); }) : 0;
+    double karatsuba = time_us([&] { return BigInteger::sqr_karatsuba(a); });
+    double toom3 = time_us([&] { return BigInteger::sqr_toom(a, 3); });
+    double toom4 = time_us([&] { return BigInteger::sqr_toom(a, 4); });
+    double ntt = time_us([&] { return BigInteger::sqr_ntt(a); });
+    double product = time_us([&] { return a * b; });
+    std::printf("%8zu %12.2f %12.2f %12.2f %12.2f %12.2f %12.2f\n", size, basecase, karatsuba,
+                toom3, toom4, ntt, product);
+  }
+}
+
+// Division of 2n by n digits: Knuth's Algorithm D vs Burnikel-Ziegler, n x n product for reference
+void bench_div_crossover() {
+  std::printf("== division crossover (us per 2n / n division) ==\n");
+  std::printf("%8s %12s %12s %12s\n", "n", "knuth", "bz", "n*n mul");
+  std::mt19937_64 rng(43);
+  for (size_t size : {32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384}) {
+    BigInteger a = random_big(rng, 2 * size), b = random_big(rng, size);
+    double knuth = time_us([&] { return BigInteger::div_knuth(a, b, nullptr); });
+    double bz = time_us([&] { return BigInteger::div_burnikel_ziegler(a, b, nullptr); });
+    double mul = time_us([&] { return b * b; });
+    std::printf("%8zu %12.2f %12.2f %12.2f\n", size, knuth, bz, mul);
+  }
+}
+
+#if X86_KERNELS == 1
+// Digits added (subtracted) per TSC cycle by every add/sub kernel the CPU supports
+void bench_add_kernels() {
+  using kernel = digit (*)(digit *, const digit *, const digit *, size_t);
+  struct entry {
+    const char *name;
+    bool supported;
+    kernel add, sub;
+  };
+  const entry kernels[] = {
+      {"generic", true, add_n_generic, sub_n_generic},
+      {"adc", true, add_n_adc, sub_n_adc},
+      {"avx512", bool(__builtin_cpu_supports("avx512f")), add_n_avx512, sub_n_avx512}};
+  std::printf("== add/sub kernels (digits per cycle) ==\n");
+  std::printf("%8s %8s %12s %12s\n", "digits", "kernel", "add", "sub");
+  std::mt19937_64 rng(44);
+  for (size_t size : {16, 256, 4096, 65536}) {
+    std::vector<digit> lhs(size), rhs(size), result(size);
+    for (size_t i = 0; i < size; ++i) lhs[i] = rng(), rhs[i] = rng();
+    for (const auto &k : kernels) {
+      if (!k.supported) continue;
+      // Cycles are read around the same repeated runs as time_us, per digit of one run
+      auto digits_per_cycle = [&](kernel fn) {
+        uint64_t cycles = 0, runs = 0;
+        time_us([&] {
+          uint64_t start = __rdtsc();
+          fn(result.data(), lhs.data(), rhs.data(), size);
+          cycles += __rdtsc() - start;
+          ++runs;
+        });
+        return double(size) * double(runs) / double(cycles);
+      };
+      std::printf("%8zu %8s %12.2f %12.2f\n", size, k.name, digits_per_cycle(k.add),
+                  digits_per_cycle(k.sub));
+    }
+  }
+}
+
+// Digits per TSC cycle of addmul_1, the inner loop of schoolbook multiplication
+void bench_addmul_kernels() {
+  using kernel = digit (*)(digit *, const digit *, size_t, digit);
+  struct entry {
+    const char *name;
+    bool supported;
+    kernel addmul;
+  };
+  const entry kernels[] = {
+      {"generic", true, addmul_1_generic},
+      {"adx", __builtin_cpu_supports("adx") && __builtin_cpu_supports("bmi2"), addmul_1_adx}};
+  std::printf("== addmul_1 kernels (digits per cycle) ==\n");
+  std::printf("%8s %8s %12s\n", "digits", "kernel", "addmul");
+  std::mt19937_64 rng(45);
+  for (size_t size : {16, 64, 256, 4096}) {
+    std::vector<digit> lhs(size), result(size);
+    for (size_t i = 0; i < size; ++i) lhs[i] = rng(), result[i] = rng();
+    auto multiplier = static_cast<digit>(rng());
+    for (const auto &k : kernels) {
+      if (!k.supported) continue;
+      uint64_t cycles = 0, runs = 0;
+      time_us([&] {
+        uint64_t start = __rdtsc();
+        k.addmul(result.data(), lhs.data(), size, multiplier);
+        cycles += __rdtsc() - start;
+        ++runs;
+      });
+      std::printf("%8zu %8s %12.2f\n", size, k.name, double(size) * double(runs) / double(cycles));
+    }
+  }
+}
+#endif
+
+// Factorial and rational workloads of test/test.cpp, scaled up: global heap vs one monotonic arena
+// per run that is released in one shot. Threads run the same workload concurrently
+void bench_allocation() {
+  auto factorial = [] {
+    BigInteger result(1);
+    for (int i = 1; i <= 1000; i++) result *= i;
+    return result.size();
+  };
+  auto harmonic = [] {
+    BigRational sum(0, 1);
+    for (int i = 1; i <= 200; i++) sum += BigRational(1, i);
+    return sum.numerator.size();
+  };
+  std::printf("== allocation (us per workload, per thread) ==\n");
+  std::printf("%8s %10s %12s %12s\n", "threads", "workload", "heap", "arena");
+  size_t max_threads = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+  for (size_t threads : {size_t(1), max_threads}) {
+    for (auto [name, workload] : {std::pair<const char *, size_t (*)()>{"factorial", factorial},
+                                  std::pair<const char *, size_t (*)()>{"harmonic", harmonic}}) {
+      auto run = [&](bool arena) {
+        std::vector<double> times(threads);
+        std::vector<std::thread> pool;
+        for (size_t t = 0; t < threads; ++t) {
+          pool.emplace_back([&, t] {
+            std::pmr::monotonic_buffer_resource resource(size_t(1) << 20);
+            times[t] = time_us([&] {
+              if (!arena) return workload();
+              size_t result;
+              {
+                DigitResourceScope scope(&resource);
+                result = workload();
+              }
+              resource.release();
+              return result;
+            });
+          });
+        }
+        for (auto &thread : pool) thread.join();
+        double total = 0;
+        for (double time : times) total += time;
+        return total / static_cast<double>(threads);
+      };
+      double heap = run(false), arena = run(true);
+      std::printf("%8zu %10s %12.2f %12.2f\n", threads, name, heap, arena);
+    }
+  }
+}
+
+// GCD of two random numbers of the same size: Euclid with full divisions, Lehmer steps only and
+// with the half-gcd recursion above {hgcd_threshold}
+void bench_gcd() {
+  std::printf("== gcd (us per gcd) ==\n");
+  std::printf("%8s %12s %12s %12s\n", "digits", "euclid", "lehmer", "hgcd");
+  std::mt19937_64 rng(46);
+  size_t threshold = hgcd_threshold;
+  for (size_t size : {4, 16, 64, 256, 1024, 4096, 16384}) {
+    BigInteger a = random_big(rng, size), b = random_big(rng, size);
+    double euclid = size <= 1024 ? time_us([&] {
+      BigInteger x = a, y = b;
+      while (!y.is_zero()) {
+        x %= y;
+        std::swap(x, y);
+      }
+      return x;
+    })
+                                 : 0;
+    hgcd_threshold = SIZE_MAX;
+    double lehmer = size <= 4096 ? time_us([&] { return gcd(a, b); }) : 0;
+    hgcd_threshold = threshold;
+    double hgcd = time_us([&] { return gcd(a, b); });
+    std::printf("%8zu %12.2f %12.2f %12.2f\n", size, euclid, lehmer, hgcd);
+  }
+}
+
+// Sum of n terms 1/i, reducing every partial sum or only at the end
+void bench_rational_accumulation() {
+  std::printf("== rational accumulation (us per sum) ==\n");
+  std::printf("%8s %12s %12s\n", "terms", "eager", "lazy");
+  size_t threshold = rational_reduce_threshold;
+  for (int terms : {10, 100, 1000}) {
+    auto harmonic = [&] {
+      BigRational sum(0, 1);
+      for (int i = 1; i <= terms; i++) sum += BigRational(1, i);
+      return sum.to_normalized();
+    };
+    rational_reduce_threshold = 0;
+    double eager = time_us(harmonic);
+    rational_reduce_threshold = SIZE_MAX;
+    double lazy = time_us(harmonic);
+    std::printf("%8d %12.2f %12.2f\n", terms, eager, lazy);
+  }
+  rational_reduce_threshold = threshold;
+}
+
+// Sum and product of reduced rationals whose denominators share a factor: gcd splitting against
+// full cross products reduced afterwards (what the lazy mode computes)
+void bench_rational_ops() {
+  std::printf("== rational ops (us per op) ==\n");
+  std::printf("%8s %12s %12s %12s %12s\n", "digits", "add split", "add cross", "mul split",
+              "mul cross");
+  std::mt19937_64 rng(47);
+  size_t threshold = rational_reduce_threshold;
+  for (size_t size : {2, 8, 32, 128, 512}) {
+    BigInteger common = random_big(rng, size / 2 + 1);
+    BigRational a(random_big(rng, size).to_string(), (random_big(rng, size) * common).to_string());
+    BigRational b(random_big(rng, size).to_string(), (random_big(rng, size) * common).to_string());
+    rational_reduce_threshold = 0;
+    double add_split = time_us([&] { return a + b; });
+    double mul_split = time_us([&] { return a * b; });
+    rational_reduce_threshold = SIZE_MAX;
+    double add_cross = time_us([&] { return (a + b).to_normalized(); });
+    double mul_cross = time_us([&] { return (a * b).to_normalized(); });
+    std::printf("%8zu %12.2f %12.2f %12.2f %12.2f\n", size, add_split, add_cross, mul_split,
+                mul_cross);
+  }
+  rational_reduce_threshold = threshold;
+}
+
+// Comparisons of negative integers equal up to the lowest digit, and of rationals far apart
+// (decided by bit lengths) or close together (cross products)
+void bench_compare() {
+  std::printf("== comparison (ns per comparison) ==\n");
+  std::printf("%8s %12s %12s %12s\n", "digits", "integer", "rational far", "rational close");
+  std::mt19937_64 rng(48);
+  volatile bool sink = false;
+  for (size_t size : {1, 8, 64, 512}) {
+    BigInteger a = -random_big(rng, size), b = a - 1;
+    BigRational x(random_big(rng, size).to_string(), random_big(rng, size).to_string());
+    BigRational far = x * BigRational(1000, 1), close = x + BigRational(1, 1000000007);
+    double integer = time_us([&] { sink = a < b; }) * 1000;
+    double rational_far = time_us([&] { sink = x < far; }) * 1000;
+    double rational_close = time_us([&] { sink = x < close; }) * 1000;
+    std::printf("%8zu %12.1f %12.1f %12.1f\n", size, integer, rational_far, rational_close);
+  }
+}
+
+// base^exp by repeated multiplication against pow, for a one-digit base and a four-digit one, and
+// the schoolbook square against the schoolbook product
+void bench_pow() {
+  std::printf("== pow (us per power) ==\n");
+  std::printf("%8s %12s %12s %12s %12s\n", "exp", "3 loop", "3 pow", "4d loop", "4d pow");
+  std::mt19937_64 rng(49);
+  BigInteger small(3), large = random_big(rng, 4);
+  auto loop = [](const BigInteger &base, size_t exp) {
+    BigInteger result(1);
+    for (size_t i = 0; i < exp; ++i) result *= base;
+    return result;
+  };
+  for (size_t exp : {10, 100, 1000, 10000}) {
+    double small_loop = time_us([&] { return loop(small, exp); });
+    double small_pow = time_us([&] { return pow(small, exp); });
+    double large_loop = exp <= 1000 ? time_us([&] { return loop(large, exp); }) : 0;
+    double large_pow = time_us([&] { return pow(large, exp); });
+    std::printf("%8zu %12.2f %12.2f %12.2f %12.2f\n", exp, small_loop, small_pow, large_loop,
+                large_pow);
+  }
+  std::printf("%8s %12s %12s\n", "digits", "mul", "sqr");
+  for (size_t size : {4, 16, 32, 64, 95}) {
+    BigInteger x = random_big(rng, size);
+    double mul = time_us([&] { return BigInteger::mul_basecase(x, x); });
+    double sqr = time_us([&] { return BigInteger::sqr_basecase(x); });
+    std::printf("%8zu %12.3f %12.3f\n", size, mul, sqr);
+  }
+}
+
+// Square root by bisection (the former isqrt) against the Karatsuba square root, and cube roots
+void bench_roots() {
+  std::printf("== roots (us per root) ==\n");
+  std::printf("%8s %12s %12s %12s\n", "digits", "bisection", "sqrt_rem", "iroot(3)");
+  std::mt19937_64 rng(51);
+  auto bisection = [](const BigInteger &number) {
+    BigInteger left(0), right = number + 1;
+    while (left != right - 1) {
+      BigInteger mid = (left + right) / digit(2);
+      if (square(mid) <= number) {
+        left = mid;
+      } else {
+        right = mid;
+      }
+    }
+    return left;
+  };
+  for (size_t size : {2, 16, 128, 1563, 16384}) {
+    BigInteger x = random_big(rng, size);
+    double slow = size <= 128 ? time_us([&] { return bisection(x); }) : 0;
+    double fast = time_us([&] { return x.sqrt_rem(); });
+    double cube = time_us([&] { return x.iroot(3); });
+    std::printf("%8zu %12.2f %12.2f %12.2f\n", size, slow, fast, cube);
+  }
+}
+
+// base^exp mod m with exp and m of the same size: sliding windows reducing with operator% against
+// powmod (Montgomery for odd m, CRT split for even m)
+void bench_powmod() {
+  std::printf("== powmod (ms per power) ==\n");
+  std::printf("%8s %12s %12s %12s\n", "bits", "division", "montgomery", "even");
+  std::mt19937_64 rng(52);
+  for (size_t bits : {1024, 2048, 4096, 8192}) {
+    size_t size = bits / digit_size;
+    BigInteger mod = random_big(rng, size), base = random_big(rng, size) % mod;
+    BigInteger exp = random_big(rng, size);
+    mod.digits[0] |= 1;
+    BigInteger even = mod + 1;
+    double division = time_us([&] {
+      return window_pow(
+          base, exp, [&](const BigInteger &x) { return x * x % mod; },
+          [&](const BigInteger &x, const BigInteger &y) { return x * y % mod; });
+    });
+    double montgomery = time_us([&] { return powmod(base, exp, mod); });
+    double split = time_us([&] { return powmod(base, exp, even); });
+    std::printf("%8zu %12.2f %12.2f %12.2f\n", bits, division / 1000, montgomery / 1000,
+                split / 1000);
+  }
+}
+
+void bench_barrett() {
+  std::printf("== reduction of x < m^2 (us per value) ==\n");
+  std::printf("%8s %12s %12s %12s\n", "digits", "division", "barrett", "batch");
+  std::mt19937_64 rng(53);
+  for (size_t size : {4, 16, 64, 256, 1024}) {
+    BigInteger mod = random_big(rng, size);
+    BarrettReducer reducer(mod);
+    std::vector<BigInteger> values(64);
+    for (BigInteger &value : values) value = random_big(rng, 2 * size) % (mod * mod);
+    double division = time_us([&] {
+      BigInteger sum;
+      for (const BigInteger &value : values) sum += value % mod;
+      return sum;
+    });
+    double barrett = time_us([&] {
+      BigInteger sum;
+      for (const BigInteger &value : values) sum += reducer.reduce(value);
+      return sum;
+    });
+    double batch = time_us([&] {
+      std::vector<BigInteger> copy = values;
+      reducer.reduce(std::span<BigInteger>(copy));
+      return copy.back();
+    });
+    std::printf("%8zu %12.3f %12.3f %12.3f\n", size, division / values.size(),
+                barrett / values.size(), batch / values.size());
+  }
+}
+
+void bench_special_modulus() {
+  std::printf("== 2^k - c moduli (us per reduction of x < m^2, ms per powmod) ==\n");
+  std::printf("%8s %10s %10s %10s %12s %12s\n", "k", "division", "barrett", "folding",
+              "montgomery", "folding");
+  std::mt19937_64 rng(54);
+  for (size_t bits : {127, 255, 521, 1279, 4253}) {
+    BigInteger mod = left_shift(BigInteger(1), bits) - (bits == 255 ? 19 : 1);
+    BarrettReducer barrett(mod);
+    SpecialModulusReducer special(mod);
+    std::vector<BigInteger> values(64);
+    for (BigInteger &value : values) value = random_big(rng, 2 * mod.size()) % (mod * mod);
+    auto per_value = [&](auto reduce) {
+      return time_us([&] {
+               BigInteger sum;
+               for (const BigInteger &value : values) sum += reduce(value);
+               return sum;
+             }) /
+             values.size();
+    };
+    double division = per_value([&](const BigInteger &x) { return x % mod; });
+    double reduced = per_value([&](const BigInteger &x) { return x % barrett; });
+    double folded = per_value([&](const BigInteger &x) { return x % special; });
+    BigInteger base = random_big(rng, mod.size()) % mod, exp = random_big(rng, mod.size());
+    double montgomery = time_us([&] { return Montgomery(mod).pow(base, exp); });
+    double folding = time_us([&] { return powmod(base, exp, mod); });
+    std::printf("%8zu %10.3f %10.3f %10.3f %12.3f %12.3f\n", bits, division, reduced, folded,
+                montgomery / 1000, folding / 1000);
+  }
+}
+
+int main() {
+  bench_special_modulus();
+  bench_barrett();
+  bench_powmod();
+  bench_roots();
+  bench_pow();
+  bench_compare();
+  bench_rational_ops();
+  bench_rational_accumulation();
+  bench_gcd();
+  bench_allocation();
+#if X86_KERNELS == 1
+  bench_add_kernels();
+  bench_addmul_kernels();
+#endif
+  bench_mul_crossover();
+  bench_sqr_crossover();
+  bench_div_crossover();
+  return 0;
+}
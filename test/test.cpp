@@ -1,10 +1,23 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <tuple>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>
 #include "../src/lib.cpp"
 
+// Random non-negative number with exactly {size} digits
+BigInteger random_big(std::mt19937_64 &rng, size_t size) {
+  BigInteger result;
+  result.digits.resize(size);
+  for (auto &d : result.digits) d = static_cast<digit>(rng());
+  if (result.digits.back() == 0) result.digits.back() = 1;
+  return result;
+}
+
 // NOTE: Implement `BigIntegerToString`. Test requires you to return string representation of BigInteger in base 10 format.
 
 TEST_CASE("Test division by two function") {
@@ -666,3 +679,877 @@ TEST_CASE("Fuzz") {
 	BigInteger a("0000000000000000000000000000000000000000");
 }
 
+
+TEST_CASE("Karatsuba multiplication") {
+  std::mt19937_64 rng(1);
+  for (auto [lhs_size, rhs_size] : {std::pair<size_t, size_t>{24, 24}, {50, 37}, {97, 30}, {200, 12}, {131, 131}}) {
+    BigInteger a = random_big(rng, lhs_size), b = random_big(rng, rhs_size);
+    BigInteger expected = BigInteger::mul_basecase(a, b);
+    CHECK(BigInteger::mul_karatsuba(a, b) == expected);
+    CHECK(a * b == expected);
+    CHECK(-a * b == -expected);
+  }
+}
+
+TEST_CASE("Toom-Cook multiplication") {
+  std::mt19937_64 rng(2);
+  for (auto [lhs_parts, rhs_parts] : {std::pair<size_t, size_t>{3, 3}, {4, 4}, {3, 2}, {4, 2}, {4, 3}}) {
+    for (auto [lhs_size, rhs_size] : {std::pair<size_t, size_t>{60, 60}, {61, 40}, {90, 31}, {17, 15}}) {
+      BigInteger a = random_big(rng, lhs_size), b = random_big(rng, rhs_size);
+      CHECK(BigInteger::mul_toom(a, b, lhs_parts, rhs_parts) == BigInteger::mul_basecase(a, b));
+    }
+  }
+  size_t saved_toom3 = toom3_threshold, saved_toom4 = toom4_threshold, saved_karatsuba = karatsuba_threshold,
+         saved_ntt = ntt_threshold;
+  karatsuba_threshold = 4, toom3_threshold = 8, toom4_threshold = 16, ntt_threshold = SIZE_MAX;
+  for (auto [lhs_size, rhs_size] : {std::pair<size_t, size_t>{300, 300}, {300, 210}, {300, 170}, {300, 120}, {300, 90}}) {
+    BigInteger a = random_big(rng, lhs_size), b = random_big(rng, rhs_size);
+    CHECK(a * b == BigInteger::mul_basecase(a, b));
+  }
+  // Every size threshold can go down to 0, Karatsuba acts as 2 and Burnikel-Ziegler as 1
+  std::vector<BigInteger> lhs, rhs, gcds;
+  for (size_t size : std::initializer_list<size_t>{1, 2, 5, 40}) {
+    lhs.push_back(random_big(rng, 2 * size + 1)), rhs.push_back(random_big(rng, size));
+    gcds.push_back(gcd(lhs.back() * rhs.back(), rhs.back() * (rhs.back() + 1)));
+  }
+  size_t saved_sqr_karatsuba = sqr_karatsuba_threshold, saved_sqr_toom3 = sqr_toom3_threshold,
+         saved_sqr_toom4 = sqr_toom4_threshold, saved_bz = burnikel_ziegler_threshold,
+         saved_bz_offset = burnikel_ziegler_offset, saved_hgcd = hgcd_threshold;
+  karatsuba_threshold = toom3_threshold = toom4_threshold = 0;
+  sqr_karatsuba_threshold = sqr_toom3_threshold = sqr_toom4_threshold = 0;
+  burnikel_ziegler_threshold = burnikel_ziegler_offset = hgcd_threshold = 0;
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    const BigInteger &a = lhs[i], &b = rhs[i];
+    CHECK(a * b == BigInteger::mul_basecase(a, b));
+    CHECK(square(a) == BigInteger::mul_basecase(a, a));
+    BigInteger expected_remainder;
+    BigInteger expected = BigInteger::div_knuth(a, b, &expected_remainder);
+    CHECK(divmod(a, b) == std::pair{expected, expected_remainder});
+    CHECK(gcd(a * b, b * (b + 1)) == gcds[i]);
+  }
+  sqr_karatsuba_threshold = saved_sqr_karatsuba, sqr_toom3_threshold = saved_sqr_toom3,
+  sqr_toom4_threshold = saved_sqr_toom4, burnikel_ziegler_threshold = saved_bz,
+  burnikel_ziegler_offset = saved_bz_offset, hgcd_threshold = saved_hgcd;
+  karatsuba_threshold = saved_karatsuba, toom3_threshold = saved_toom3, toom4_threshold = saved_toom4,
+  ntt_threshold = saved_ntt;
+}
+
+TEST_CASE("NTT multiplication") {
+  std::mt19937_64 rng(3);
+  for (auto [lhs_size, rhs_size] : {std::pair<size_t, size_t>{1, 1}, {100, 100}, {333, 7}, {1000, 999}}) {
+    BigInteger a = random_big(rng, lhs_size), b = random_big(rng, rhs_size);
+    CHECK(BigInteger::mul_ntt(a, b) == BigInteger::mul_karatsuba(a, b));
+  }
+  // All digits at maximum give the largest convolution terms
+  BigInteger max_digits;
+  max_digits.digits.assign(3000, digit_max);
+  CHECK(BigInteger::mul_ntt(max_digits, max_digits) == BigInteger::mul_toom(max_digits, max_digits, 3, 3));
+  BigInteger a = random_big(rng, 6000), b = random_big(rng, 5000);
+  CHECK(a * b == BigInteger::mul_toom(a, b, 4, 4));
+}
+
+TEST_CASE("Knuth division") {
+  std::mt19937_64 rng(4);
+  for (auto [lhs_size, rhs_size] : {std::pair<size_t, size_t>{2, 2}, {5, 2}, {40, 13}, {300, 150}, {301, 300}}) {
+    BigInteger a = random_big(rng, lhs_size), b = random_big(rng, rhs_size);
+    BigInteger remainder;
+    BigInteger quotient = BigInteger::div_knuth(a, b, &remainder);
+    CHECK(quotient * b + remainder == a);
+    CHECK(remainder < b);
+    CHECK(a / b == quotient);
+    CHECK(-a / b == -quotient);
+    CHECK(a % b == remainder);
+  }
+  // Divisor {1, 0, 2^(digit_size - 1)} forces the add back step
+  BigInteger dividend, divisor;
+  dividend.digits = {0, 0, digit(1) << (digit_size - 1), digit_max >> 1};
+  divisor.digits = {1, 0, digit(1) << (digit_size - 1)};
+  BigInteger remainder;
+  BigInteger quotient = BigInteger::div_knuth(dividend, divisor, &remainder);
+  CHECK(quotient * divisor + remainder == dividend);
+  CHECK(remainder < divisor);
+  CHECK(BigInteger(1) / BigInteger(-1) == BigInteger(-1));
+}
+
+TEST_CASE("Burnikel-Ziegler division") {
+  std::mt19937_64 rng(5);
+  size_t saved_threshold = burnikel_ziegler_threshold, saved_offset = burnikel_ziegler_offset;
+  burnikel_ziegler_threshold = 4, burnikel_ziegler_offset = 2;
+  for (auto [lhs_size, rhs_size] : {std::pair<size_t, size_t>{16, 8}, {100, 37}, {256, 128}, {500, 16}, {333, 200}}) {
+    BigInteger a = random_big(rng, lhs_size), b = random_big(rng, rhs_size);
+    BigInteger remainder, expected_remainder;
+    BigInteger quotient = BigInteger::div_burnikel_ziegler(a, b, &remainder);
+    CHECK(quotient == BigInteger::div_knuth(a, b, &expected_remainder));
+    CHECK(remainder == expected_remainder);
+    CHECK(a / b == quotient);
+  }
+  // Thresholds below 1 act as 1
+  burnikel_ziegler_threshold = 0, burnikel_ziegler_offset = 0;
+  for (auto [lhs_size, rhs_size] : {std::pair<size_t, size_t>{1, 1}, {3, 1}, {9, 4}, {40, 7}}) {
+    BigInteger a = random_big(rng, lhs_size), b = random_big(rng, rhs_size);
+    BigInteger expected_remainder;
+    BigInteger expected = BigInteger::div_knuth(a, b, &expected_remainder);
+    auto [quotient, remainder] = divmod(a, b);
+    CHECK(quotient == expected);
+    CHECK(remainder == expected_remainder);
+  }
+  burnikel_ziegler_threshold = saved_threshold, burnikel_ziegler_offset = saved_offset;
+  BigInteger a = random_big(rng, 2000), b = random_big(rng, 900);
+  CHECK((a * b + b - 1) / b == a);
+}
+
+TEST_CASE("divmod") {
+  for (auto [lhs, rhs] : {std::pair<int64_t, int64_t>{10, 3}, {-10, 3}, {10, -3}, {-10, -3}, {2, 5}, {-2, 5}, {0, 7}}) {
+    auto [quotient, remainder] = divmod(BigInteger(lhs), BigInteger(rhs));
+    CHECK(quotient == BigInteger(lhs / rhs));
+    CHECK(remainder == BigInteger(lhs % rhs));
+  }
+  std::mt19937_64 rng(6);
+  BigInteger a = random_big(rng, 120), b = random_big(rng, 50);
+  BigInteger quotient = -a;
+  BigInteger remainder = quotient.div_rem(b);
+  CHECK(quotient == -a / b);
+  CHECK(remainder == -a % b);
+  CHECK(quotient * b + remainder == -a);
+  CHECK_THROWS(divmod(a, BigInteger(0)));
+}
+
+TEST_CASE("Decimal parsing") {
+  std::mt19937_64 rng(7);
+  std::string text;
+  for (size_t i = 0; i < 5000; ++i) text.push_back(static_cast<char>('0' + rng() % 10));
+  text[0] = '7';
+  BigInteger expected;
+  for (char c : text) expected.mul_add_digit(10, static_cast<digit>(c - '0'));
+  CHECK(BigInteger(text) == expected);
+  CHECK(BigInteger("-" + text) == -expected);
+  size_t saved_threshold = decimal_dc_threshold;
+  decimal_dc_threshold = 20;
+  CHECK(BigInteger(text) == expected);
+  CHECK(BigInteger("000000000000000000000000000000" + text) == expected);
+  // Thresholds at or below one chunk still parse short strings by chunks
+  for (size_t threshold : std::initializer_list<size_t>{1, 5, 19}) {
+    decimal_dc_threshold = threshold;
+    CHECK(BigInteger("12345678901") == BigInteger(12345678901));
+    CHECK(BigInteger("-7") == -7);
+    CHECK(BigInteger(text.substr(0, 300)).to_string() == text.substr(0, 300));
+    CHECK(BigInteger(text) == expected);
+  }
+  decimal_dc_threshold = saved_threshold;
+  CHECK(BigIntegerToString(BigInteger(text)) == text);
+  CHECK(BigInteger("-0").negative == false);
+}
+
+TEST_CASE("Decimal printing") {
+  std::mt19937_64 rng(8);
+  std::string text;
+  for (size_t i = 0; i < 6000; ++i) text.push_back(static_cast<char>('0' + rng() % 10));
+  text[0] = '3';
+  // Zeros in the middle exercise padding of the lower halves
+  text.replace(2000, 300, 300, '0');
+  CHECK(BigInteger(text).to_string() == text);
+  CHECK(BigInteger("-" + text).to_string() == "-" + text);
+  size_t saved_threshold = decimal_dc_threshold;
+  decimal_dc_threshold = 20;
+  CHECK(BigInteger(text).to_string() == text);
+  CHECK(BigInteger("1" + std::string(500, '0')).to_string() == "1" + std::string(500, '0'));
+  // Thresholds at or below one digit of decimals still print single digits by chunks
+  std::vector<BigInteger> values = {BigInteger(12345), BigInteger(-7), BigInteger(0),
+                                    BigInteger(text), left_shift(BigInteger(1), 64) - 1};
+  std::vector<std::string> expected;
+  for (const BigInteger &value : values) expected.push_back(value.to_string());
+  for (size_t threshold : std::initializer_list<size_t>{1, 19}) {
+    decimal_dc_threshold = threshold;
+    for (size_t i = 0; i < values.size(); ++i) CHECK(values[i].to_string() == expected[i]);
+  }
+  decimal_dc_threshold = saved_threshold;
+  CHECK(BigInteger(1000000000).to_string() == "1000000000");
+}
+
+TEST_CASE("In-place and rvalue arithmetics") {
+  BigInteger a("123456789123456789123456789"), b("-987654321987654321");
+  BigInteger x = a;
+  x += x;
+  CHECK(x == a * 2);
+  x -= x;
+  CHECK(x == BigInteger(0));
+  CHECK_FALSE(x.negative);
+  x = b;
+  x -= a;
+  CHECK(x == BigInteger("-123456790111111111111111110"));
+  x += a;
+  CHECK(x == b);
+  x *= BigInteger(-3);
+  CHECK(x == BigInteger("2962962965962962963"));
+  CHECK(BigInteger(a) + b == a + b);
+  CHECK(a + BigInteger(b) == a + b);
+  CHECK(BigInteger(a) - b == a - b);
+  CHECK(a - BigInteger(b) == a - b);
+  CHECK(BigInteger(b) - BigInteger(a) == b - a);
+  CHECK(-BigInteger(a) == BigInteger("-123456789123456789123456789"));
+  BigInteger moved = std::move(x);
+  CHECK(moved == BigInteger("2962962965962962963"));
+}
+
+TEST_CASE("Inline digit storage") {
+  CHECK(BigInteger().digits.is_inline());
+  CHECK(BigInteger(std::numeric_limits<int64_t>::min()).digits.is_inline());
+  BigInteger a = BigInteger(1) - BigInteger(2) * BigInteger(3);
+  CHECK(a.digits.is_inline());
+  BigInteger big = left_shift(BigInteger(1), digit_inline_capacity * digit_size);
+  CHECK_FALSE(big.digits.is_inline());
+  BigInteger moved = std::move(big);
+  CHECK(moved == left_shift(BigInteger(1), digit_inline_capacity * digit_size));
+  moved.digits = {1, 2};
+  CHECK(moved.digits.size() == 2);
+  moved.digits.assign(moved.digits.begin() + 1, moved.digits.end());
+  CHECK(moved == BigInteger(2));
+}
+
+TEST_CASE("Digit size limits", "[BigInteger]") {
+  CHECK(BigInteger(std::numeric_limits<int64_t>::min()).to_string() == "-9223372036854775808");
+  CHECK(BigInteger(std::numeric_limits<int64_t>::max()).to_string() == "9223372036854775807");
+  CHECK((BigInteger(0) + digit_max) == BigInteger::from_digit(digit_max));
+  CHECK((BigInteger(0) - digit_max) == -BigInteger::from_digit(digit_max));
+  CHECK((BigInteger(1) * digit_max) == BigInteger::from_digit(digit_max));
+  CHECK((BigInteger(-1) + digit_max) == BigInteger::from_digit(digit_max) - 1);
+
+  // All-ones digits make every NTT coefficient and carry as large as possible
+  size_t saved = ntt_threshold;
+  BigInteger ones;
+  ones.digits.assign(300, digit_max);
+  ntt_threshold = SIZE_MAX;
+  BigInteger expected = ones * ones;
+  ntt_threshold = 1;
+  CHECK(ones * ones == expected);
+  CHECK(expected == left_shift(BigInteger(1), 600 * digit_size) -
+                        left_shift(BigInteger(1), 300 * digit_size + 1) + 1);
+  ntt_threshold = saved;
+}
+
+TEST_CASE("Add and sub kernels", "[BigInteger]") {
+  using kernel = digit (*)(digit *, const digit *, const digit *, size_t);
+  std::vector<std::pair<kernel, kernel>> kernels = {{add_n_generic, sub_n_generic}};
+#if X86_KERNELS == 1
+  kernels.push_back({add_n_adc, sub_n_adc});
+  if (__builtin_cpu_supports("avx512f")) kernels.push_back({add_n_avx512, sub_n_avx512});
+#endif
+  std::mt19937_64 rng(12);
+  for (size_t n : std::initializer_list<size_t>{0, 1, 3, 4, 7, 8, 9, 17, 64, 100}) {
+    // Runs of all-ones and zero digits make carries and borrows ripple across lanes
+    std::vector<digit> lhs(n), rhs(n);
+    for (size_t i = 0; i < n; ++i) {
+      auto pick = rng() % 4;
+      lhs[i] = pick == 0 ? digit_max : pick == 1 ? 0 : static_cast<digit>(rng());
+      rhs[i] = pick == 0 ? rng() % 2 : pick == 1 ? 0 : static_cast<digit>(rng());
+    }
+    std::vector<digit> expected_sum(n), expected_diff(n);
+    digit expected_carry = add_n_generic(expected_sum.data(), lhs.data(), rhs.data(), n);
+    digit expected_borrow = sub_n_generic(expected_diff.data(), lhs.data(), rhs.data(), n);
+    for (auto [add, sub] : kernels) {
+      std::vector<digit> sum(n), diff = lhs;
+      CHECK(add(sum.data(), lhs.data(), rhs.data(), n) == expected_carry);
+      CHECK(sum == expected_sum);
+      CHECK(sub(diff.data(), diff.data(), rhs.data(), n) == expected_borrow);
+      CHECK(diff == expected_diff);
+    }
+  }
+  BigInteger all_ones;
+  all_ones.digits.assign(20, digit_max);
+  CHECK(all_ones + 1 == left_shift(BigInteger(1), 20 * digit_size));
+  CHECK(left_shift(BigInteger(1), 20 * digit_size) - all_ones == 1);
+}
+
+TEST_CASE("Multiply kernels", "[BigInteger]") {
+  using kernel = digit (*)(digit *, const digit *, size_t, digit);
+  std::vector<kernel> kernels = {addmul_1_generic};
+#if X86_KERNELS == 1
+  if (__builtin_cpu_supports("adx") && __builtin_cpu_supports("bmi2"))
+    kernels.push_back(addmul_1_adx);
+#endif
+  std::mt19937_64 rng(13);
+  for (size_t n : std::initializer_list<size_t>{0, 1, 3, 4, 5, 8, 13, 64}) {
+    for (digit multiplier : {digit(0), digit(1), digit_max, static_cast<digit>(rng())}) {
+      // All-ones operands push every carry chain to its maximum
+      std::vector<digit> lhs(n, digit_max), accumulator(n, digit_max);
+      if (n > 2) lhs[1] = static_cast<digit>(rng()), accumulator[2] = static_cast<digit>(rng());
+      BigInteger lhs_big, accumulator_big;
+      if (n != 0) lhs_big.digits.assign(lhs.data(), lhs.data() + n);
+      if (n != 0) accumulator_big.digits.assign(accumulator.data(), accumulator.data() + n);
+      lhs_big.trim();
+      accumulator_big.trim();
+      BigInteger expected = accumulator_big + lhs_big * multiplier;
+      for (auto addmul : kernels) {
+        std::vector<digit> result = accumulator;
+        digit carry = addmul(result.data(), lhs.data(), n, multiplier);
+        result.push_back(carry);
+        BigInteger actual;
+        actual.digits.assign(result.data(), result.data() + result.size());
+        actual.trim();
+        CHECK(actual == expected);
+      }
+    }
+  }
+  // Knuth division with q_hat * divisor subtracted by submul_1
+  BigInteger a = random_big(rng, 40), b = random_big(rng, 17);
+  auto [quotient, remainder] = divmod(a, b);
+  CHECK(quotient * b + remainder == a);
+  CHECK(remainder < b);
+}
+
+TEST_CASE("Digit memory resource", "[BigInteger]") {
+  // Counts blocks taken from and given back to the global heap through it
+  struct counting_resource : std::pmr::memory_resource {
+    size_t allocated = 0, deallocated = 0;
+    void *do_allocate(size_t bytes, size_t alignment) override {
+      ++allocated;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *pointer, size_t bytes, size_t alignment) override {
+      ++deallocated;
+      std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+      return this == &other;
+    }
+  } counting;
+
+  BigInteger outside = left_shift(BigInteger(1), 10 * digit_size);
+  {
+    DigitResourceScope scope(&counting);
+    BigInteger factorial(1);
+    for (int i = 1; i <= 100; i++) factorial *= i;
+    CHECK(factorial.to_string().substr(0, 10) == "9332621544");
+    CHECK(counting.allocated > 0);
+    // Storage that was already on the heap keeps its own resource
+    size_t before = counting.allocated;
+    outside *= BigInteger::from_digit(digit_max);
+    outside += outside;
+    CHECK(counting.allocated == before);
+  }
+  CHECK(counting.allocated == counting.deallocated);
+  CHECK(digit_resource == nullptr);
+
+  // Whole computation out of a monotonic arena, released in one shot
+  std::pmr::monotonic_buffer_resource arena;
+  {
+    DigitResourceScope scope(&arena);
+    BigRational sum(0, 1);
+    for (int i = 1; i <= 20; ++i) sum += BigRational(1, i);
+    CHECK(sum == BigRational("55835135", "15519504"));
+    BigInteger big("123456789012345678901234567890123456789012345678901234567890");
+    CHECK((big * big / big) == big);
+  }
+  arena.release();
+}
+
+// Every global heap allocation of the test binary is counted, so the scratch test can assert none
+// happen in steady state. Kept out of line, so the compiler does not pair malloc with delete
+static thread_local size_t heap_allocations = 0;
+__attribute__((noinline)) void *operator new(size_t size) {
+  ++heap_allocations;
+  if (void *pointer = std::malloc(size == 0 ? 1 : size)) return pointer;
+  throw std::bad_alloc();
+}
+__attribute__((noinline)) void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  ++heap_allocations;
+  return std::malloc(size == 0 ? 1 : size);
+}
+__attribute__((noinline)) void operator delete(void *pointer) noexcept { std::free(pointer); }
+__attribute__((noinline)) void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
+__attribute__((noinline)) void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  std::free(pointer);
+}
+
+TEST_CASE("Scratch digits", "[BigInteger]") {
+  std::mt19937_64 rng(15);
+  BigInteger x = random_big(rng, 40), y = random_big(rng, 40), modulus = random_big(rng, 37);
+  BigInteger a = random_big(rng, 150), b = random_big(rng, 150), product;
+  BigInteger p = random_big(rng, 12), q = random_big(rng, 11), root;
+  auto step = [&] {
+    x *= y;
+    x %= modulus;
+    x += y;
+    x -= modulus;
+    product = a * b;  // Karatsuba
+    product /= b;
+    root = product.isqrt();
+    root = BigRational::gcd(p * q, q * q);
+  };
+  step();
+  step();
+  size_t before = heap_allocations;
+  for (int i = 0; i < 20; ++i) step();
+  CHECK(heap_allocations == before);
+  CHECK(product == a);
+  CHECK(root == q);
+
+  // Retention is bounded, released on demand and off at 0
+  CHECK(DigitScratch::retained() > 0);
+  BigInteger large = random_big(rng, 20000);
+  for (int i = 0; i < 4; ++i) large = square(large).slice(0, 20000);
+  CHECK(DigitScratch::retained() <= scratch_max_digits);
+  DigitScratch::release();
+  CHECK(DigitScratch::retained() == 0);
+  size_t saved_max = scratch_max_digits;
+  scratch_max_digits = 0;
+  step();
+  CHECK(DigitScratch::retained() == 0);
+  CHECK(product == a);
+  scratch_max_digits = saved_max;
+}
+
+TEST_CASE("GCD", "[BigInteger]") {
+  auto euclid = [](BigInteger a, BigInteger b) {
+    a.negative = b.negative = false;
+    while (!b.is_zero()) {
+      a %= b;
+      std::swap(a, b);
+    }
+    return a;
+  };
+  CHECK(gcd(BigInteger(0), BigInteger(0)) == 0);
+  CHECK(gcd(BigInteger(0), BigInteger(-7)) == 7);
+  CHECK(gcd(BigInteger(12), BigInteger(-18)) == 6);
+  CHECK(gcd(BigInteger(-1), left_shift(BigInteger(1), 200)) == 1);
+  // Fibonacci neighbours give the longest remainder sequence
+  BigInteger f1(1), f2(1);
+  for (int i = 0; i < 3000; ++i) f1 += f2, std::swap(f1, f2);
+  CHECK(gcd(f1, f2) == 1);
+
+  size_t saved = hgcd_threshold;
+  std::mt19937_64 rng(16);
+  for (size_t threshold : {size_t(8), saved}) {
+    hgcd_threshold = threshold;
+    for (auto [lhs_size, rhs_size, common_size] :
+         {std::tuple<size_t, size_t, size_t>{1, 1, 1}, {2, 3, 1}, {5, 5, 2}, {30, 20, 7}, {60, 60, 1},
+          {200, 190, 40}}) {
+      BigInteger common = random_big(rng, common_size);
+      BigInteger a = random_big(rng, lhs_size) * common, b = random_big(rng, rhs_size) * common;
+      CHECK(gcd(a, b) == euclid(a, b));
+      CHECK(gcd(b, -a) == euclid(a, b));
+    }
+    CHECK(gcd(f1 * f2, f2 * f2) == f2);
+  }
+  hgcd_threshold = saved;
+  CHECK(BigRational::gcd(BigInteger(84), BigInteger(36)) == 12);
+}
+
+TEST_CASE("Lazy rational reduction", "[BigRational]") {
+  auto harmonic = [] {
+    BigRational sum(0, 1);
+    for (int i = 1; i <= 40; ++i) sum += BigRational(i % 3 ? 1 : -1, i);
+    return sum;
+  };
+  BigRational eager = harmonic();
+  CHECK(eager.is_reduced());
+
+  size_t saved = rational_reduce_threshold;
+  rational_reduce_threshold = SIZE_MAX;
+  BigRational lazy = harmonic();
+  CHECK_FALSE(lazy.is_reduced());
+  CHECK(lazy == eager);
+  CHECK(lazy * BigRational(3, 1) > eager);
+  CHECK(-lazy < -eager * BigRational(1, 2));
+  std::stringstream lazy_text, eager_text;
+  lazy_text << lazy;
+  eager_text << eager;
+  CHECK(lazy_text.str() == eager_text.str());
+  // Reduced in place once, then never again
+  BigRational reduced = lazy.to_normalized();
+  CHECK(reduced.is_reduced());
+  CHECK(reduced.numerator == eager.numerator);
+  CHECK(reduced.denominator == eager.denominator);
+  CHECK((-reduced).is_reduced());
+  // Reduced as soon as results reach the threshold
+  rational_reduce_threshold = 2;
+  CHECK(harmonic().is_reduced());
+  CHECK(harmonic().numerator == eager.numerator);
+  rational_reduce_threshold = saved;
+
+  // Mixed signs keep the sign out of the numerator
+  BigRational difference = BigRational(-1, 2) - BigRational(-1, 3);
+  CHECK(difference == BigRational(-1, 6));
+  CHECK_FALSE(difference.numerator.negative);
+  CHECK(BigRational(1, 2) - BigRational(-1, 3) == BigRational(5, 6));
+  CHECK(BigRational(1, 4) - BigRational(3, 4) == BigRational(-1, 2));
+  CHECK(BigRational(1, 3) - BigRational(1, 3) == BigRational(0, -5));
+  std::stringstream text;
+  text << BigRational(2, -4);
+  CHECK(text.str() == "-1/2");
+
+  // Fields assigned directly are not taken as coprime
+  BigRational assigned;
+  assigned.numerator = 2;
+  assigned.denominator = 4;
+  CHECK_FALSE(assigned.is_reduced());
+  CHECK(assigned == BigRational(1, 2));
+  BigRational doubled = assigned * BigRational(2, 1);
+  CHECK(doubled == BigRational(1, 1));
+  std::stringstream assigned_text;
+  assigned_text << doubled;
+  CHECK(assigned_text.str() == "1/1");
+}
+
+TEST_CASE("Rational gcd splitting", "[BigRational]") {
+  std::mt19937_64 rng(18);
+  auto random_rational = [&](size_t size) {
+    BigInteger common = random_big(rng, 1 + rng() % 2);
+    BigInteger numerator = random_big(rng, size) * common, denominator = random_big(rng, size) * common;
+    if (rng() % 2) numerator = -numerator;
+    return BigRational(numerator.to_string(), denominator.to_string());
+  };
+  auto coprime = [](const BigRational &value) {
+    return value.is_reduced() && gcd(value.numerator, value.denominator) == 1 &&
+           !value.numerator.negative && !value.denominator.negative;
+  };
+  for (size_t size : std::initializer_list<size_t>{1, 2, 5, 20}) {
+    for (int i = 0; i < 20; ++i) {
+      BigRational a = random_rational(size), b = random_rational(size);
+      // Shared factors in the denominators are what the splitting divides out
+      if (i % 2) b *= BigRational(a.denominator.to_string(), "1");
+      BigInteger ad = a.numerator * b.denominator, bc = b.numerator * a.denominator;
+      if (a.negative) ad = -ad;
+      if (b.negative) bc = -bc;
+      BigInteger denominators = a.denominator * b.denominator;
+      BigRational sum = a + b, difference = a - b, product = a * b, quotient = a / b;
+      CHECK(sum == BigRational((ad + bc).to_string(), denominators.to_string()));
+      CHECK(difference == BigRational((ad - bc).to_string(), denominators.to_string()));
+      CHECK(quotient == BigRational(ad.to_string(), bc.to_string()));
+      CHECK(product * b == a * b * b);
+      CHECK(product / b == a);
+      CHECK((coprime(sum) && coprime(difference) && coprime(product) && coprime(quotient)));
+    }
+  }
+
+  BigRational a(-3, 4), b(5, 6);
+  a -= b;
+  CHECK(a == BigRational(-19, 12));
+  a *= BigRational(-6, 19);
+  CHECK(a == BigRational(1, 2));
+  a /= BigRational(3, 8);
+  CHECK(a == BigRational(4, 3));
+  // Aliased operands
+  a *= a;
+  CHECK(a == BigRational(16, 9));
+  a += a;
+  CHECK(a == BigRational(32, 9));
+  a /= a;
+  CHECK(a == BigRational(1, 1));
+  a -= a;
+  CHECK(a.is_zero());
+  CHECK_FALSE(a.negative);
+  CHECK_THROWS(b /= a);
+}
+
+TEST_CASE("Three-way comparison", "[BigInteger][BigRational]") {
+  BigInteger big("123456789012345678901234567890123456789012345678901234567890");
+  BigInteger big2 = big + 1;
+  CHECK((big <=> big2) == std::strong_ordering::less);
+  CHECK((-big <=> -big2) == std::strong_ordering::greater);
+  CHECK((-big <=> big) == std::strong_ordering::less);
+  CHECK((BigInteger("-0") <=> BigInteger(0)) == std::strong_ordering::equal);
+  CHECK((BigInteger(-1) <=> BigInteger(0)) == std::strong_ordering::less);
+  CHECK(-big2 < -big);
+  CHECK(-big2 <= -big2);
+  CHECK(big2 >= big);
+  CHECK_FALSE(big > big);
+  CHECK(BigInteger(-5) < digit(3));
+  CHECK_FALSE(BigInteger(-5) > digit(3));
+  CHECK(big > digit(3));
+  // No copies or temporaries, also for negative operands
+  size_t before = heap_allocations;
+  bool ordered = -big2 < -big && big < big2 && !(big2 <= big) && (big <=> big) == 0;
+  CHECK(heap_allocations == before);
+  CHECK(ordered);
+
+  std::mt19937_64 rng(19);
+  auto random_rational = [&] {
+    BigInteger numerator = random_big(rng, 1 + rng() % 4);
+    BigInteger denominator = random_big(rng, 1 + rng() % 4);
+    if (rng() % 2) numerator = -numerator;
+    return BigRational(numerator.to_string(), denominator.to_string());
+  };
+  auto reference = [](const BigRational &lhs, const BigRational &rhs) {
+    BigInteger left = lhs.numerator * rhs.denominator, right = rhs.numerator * lhs.denominator;
+    if (lhs.negative) left = -left;
+    if (rhs.negative) right = -right;
+    return left <=> right;
+  };
+  for (int i = 0; i < 200; ++i) {
+    BigRational a = random_rational(), b = random_rational();
+    // Close values that only the cross products decide
+    if (i % 3 == 0) b = a + BigRational(i % 2 ? 1 : -1, 1000000007);
+    if (i % 7 == 0) b = a;
+    CHECK((a <=> b) == reference(a, b));
+    CHECK((a < b) == (reference(a, b) < 0));
+    CHECK((a >= b) == (reference(a, b) >= 0));
+  }
+  CHECK((BigRational(0, 1) <=> BigRational(-1, 3)) == std::strong_ordering::greater);
+  CHECK((BigRational(-1, 3) <=> BigRational(-1, 2)) == std::strong_ordering::greater);
+  CHECK((BigRational(7, 3) <=> BigRational(14, 6)) == std::strong_ordering::equal);
+}
+
+TEST_CASE("Power", "[BigInteger]") {
+  auto naive = [](const BigInteger &base, size_t exp) {
+    BigInteger result(1);
+    for (size_t i = 0; i < exp; ++i) result *= base;
+    return result;
+  };
+  std::mt19937_64 rng(20);
+  for (size_t size : std::initializer_list<size_t>{1, 2, 3, 40, 130}) {
+    BigInteger x = random_big(rng, size);
+    BigInteger square;
+    square.digits.resize(2 * size);
+    sqr_basecase_n(square.digits.data(), x.digits.data(), size);
+    CHECK(square.rlz() == x * x);
+  }
+  BigInteger all_ones = BigInteger::from_digit(digit_max);
+  for (int i = 0; i < 5; ++i) all_ones = all_ones * all_ones + all_ones + all_ones;
+  CHECK(BigInteger::sqr_basecase(all_ones) == all_ones * all_ones);
+
+  std::vector<BigInteger> bases = {BigInteger(3), BigInteger(-7), BigInteger(10), BigInteger(1),
+                                   BigInteger(-1), BigInteger(-64), BigInteger(0),
+                                   BigInteger::from_digit(digit_max),
+                                   left_shift(BigInteger(5), 3 * digit_size + 3),
+                                   -random_big(rng, 3), random_big(rng, 2) * BigInteger(96)};
+  for (const BigInteger &base : bases) {
+    for (size_t exp : std::initializer_list<size_t>{0, 1, 2, 3, 7, 16, 31, 64, 77})
+      CHECK(pow(base, exp) == naive(base, exp));
+  }
+  CHECK((BigInteger(2) ^ 100) == left_shift(BigInteger(1), 100));
+  CHECK((BigInteger(-2) ^ 3) == -8);
+  CHECK(pow(BigInteger(10), 40) == BigInteger("10000000000000000000000000000000000000000"));
+  BigInteger big = random_big(rng, 2);
+  CHECK(pow(big, 600) == pow(pow(big, 30), 20));
+  CHECK(pow(BigInteger(3), 1000) == pow(BigInteger(3), 999) * 3);
+}
+
+TEST_CASE("Square", "[BigInteger]") {
+  std::mt19937_64 rng(21);
+  for (size_t size : std::initializer_list<size_t>{1, 2, 7, 33, 100, 301}) {
+    BigInteger x = random_big(rng, size), y = x;
+    BigInteger expected = x * y;
+    CHECK(BigInteger::sqr_basecase(x) == expected);
+    CHECK(BigInteger::sqr_karatsuba(x) == expected);
+    CHECK(BigInteger::sqr_toom(x, 3) == expected);
+    CHECK(BigInteger::sqr_toom(x, 4) == expected);
+    CHECK(BigInteger::sqr_ntt(x) == expected);
+    CHECK(square(-x) == expected);
+    CHECK(x * x == expected);
+    y *= y;
+    CHECK(y == expected);
+  }
+  // Every tier recursing into every other one
+  size_t saved[] = {sqr_karatsuba_threshold, sqr_toom3_threshold, sqr_toom4_threshold,
+                    sqr_ntt_threshold};
+  sqr_karatsuba_threshold = 4, sqr_toom3_threshold = 12, sqr_toom4_threshold = 40;
+  sqr_ntt_threshold = 150;
+  for (size_t size : std::initializer_list<size_t>{5, 13, 41, 160, 500}) {
+    BigInteger x = random_big(rng, size), y = x;
+    CHECK(square(x) == x * y);
+  }
+  BigInteger all_ones = left_shift(BigInteger(1), 97 * digit_size) - 1;
+  CHECK(square(all_ones) == all_ones * (all_ones + 0));
+  sqr_karatsuba_threshold = saved[0], sqr_toom3_threshold = saved[1];
+  sqr_toom4_threshold = saved[2], sqr_ntt_threshold = saved[3];
+  CHECK(square(BigInteger(0)) == 0);
+  CHECK(BigInteger(12345).isqrt() == 111);
+}
+
+TEST_CASE("Roots", "[BigInteger][BigRational]") {
+  auto check_sqrt = [](const BigInteger &number) {
+    auto [root, remainder] = number.sqrt_rem();
+    CHECK(square(root) + remainder == number);
+    CHECK_FALSE(remainder.negative);
+    CHECK(remainder <= left_shift(root, 1));
+    CHECK(number.isqrt() == root);
+  };
+  for (int i = 0; i < 100; ++i) check_sqrt(BigInteger(i));
+  std::mt19937_64 rng(22);
+  for (size_t size : std::initializer_list<size_t>{1, 2, 3, 4, 5, 9, 17, 64, 300}) {
+    for (int i = 0; i < 5; ++i) {
+      BigInteger x = random_big(rng, size);
+      x = right_shift(x, rng() % digit_size);
+      check_sqrt(x);
+      // Perfect squares and their neighbours
+      BigInteger square_x = square(x);
+      check_sqrt(square_x);
+      check_sqrt(square_x - 1);
+      check_sqrt(square_x + 1);
+      CHECK(square_x.isqrt() == x);
+      CHECK((square_x - 1).isqrt() == x - 1);
+    }
+    BigInteger all_ones = left_shift(BigInteger(1), size * digit_size) - 1;
+    check_sqrt(all_ones);
+    check_sqrt(all_ones + 1);
+  }
+  CHECK_THROWS(BigInteger(-4).isqrt());
+
+  for (size_t n : std::initializer_list<size_t>{1, 2, 3, 5, 7, 64}) {
+    for (size_t size : std::initializer_list<size_t>{1, 2, 5, 30}) {
+      BigInteger x = random_big(rng, size);
+      BigInteger root = x.iroot(n);
+      CHECK(pow(root, n) <= x);
+      CHECK(pow(root + 1, n) > x);
+      CHECK(pow(x, n).iroot(n) == x);
+      CHECK((pow(x, n) - 1).iroot(n) == x - 1);
+    }
+  }
+  CHECK(BigInteger(-27).iroot(3) == -3);
+  CHECK(BigInteger(-28).iroot(3) == -3);
+  CHECK(BigInteger(0).iroot(5) == 0);
+  CHECK(BigInteger(1).iroot(100) == 1);
+  CHECK_THROWS(BigInteger(-4).iroot(2));
+  CHECK_THROWS(BigInteger(4).iroot(0));
+
+  CHECK(BigRational(50, 2).isqrt() == 5);
+  CHECK(BigRational(99, 4).isqrt() == 4);
+  CHECK(BigRational(1, 3).isqrt() == 0);
+  CHECK_THROWS(BigRational(-1, 3).isqrt());
+  CHECK(BigRational(9, 4).sqrt() == 1.5);
+  CHECK(BigRational(0, 4).sqrt() == 0.0);
+  CHECK(BigRational(2, 1).sqrt() == Catch::Approx(std::sqrt(2.0)).epsilon(1e-15));
+  double expected = std::sqrt(1.0 / 1000000007);
+  CHECK(BigRational(1, 1000000007).sqrt() == Catch::Approx(expected).epsilon(1e-15));
+  BigRational huge(pow(BigInteger(10), 400).to_string(), pow(BigInteger(10), 100).to_string());
+  CHECK(huge.sqrt() == Catch::Approx(1e150).epsilon(1e-15));
+  BigRational tiny(BigInteger(4).to_string(), pow(BigInteger(10), 300).to_string());
+  CHECK(tiny.sqrt() == Catch::Approx(2e-150).epsilon(1e-15));
+  CHECK_THROWS(BigRational(-1, 3).sqrt());
+}
+
+TEST_CASE("Modular exponentiation", "[BigInteger]") {
+  auto reference = [](BigInteger base, const BigInteger &exp, const BigInteger &mod) {
+    BigInteger result = BigInteger(1) % mod;
+    base %= mod;
+    if (base.negative) base += mod;
+    for (size_t i = exp.bit_length(); i-- > 0;) {
+      result = result * result % mod;
+      if (!right_shift(exp, i).low_bits(1).is_zero()) result = result * base % mod;
+    }
+    return result;
+  };
+  std::mt19937_64 rng(23);
+  for (size_t size : std::initializer_list<size_t>{1, 2, 3, 8, 33}) {
+    for (size_t i = 0; i < 6; ++i) {
+      BigInteger mod = random_big(rng, size);
+      if (i % 2 == 0) mod.digits[0] |= 1;
+      if (i == 3) mod = left_shift(mod, 70);
+      BigInteger base = random_big(rng, size + 1), exp = random_big(rng, 1 + i % 3);
+      if (i == 5) base = -base;
+      CHECK(powmod(base, exp, mod) == reference(base, exp, mod));
+    }
+  }
+  BigInteger ones = left_shift(BigInteger(1), 4 * digit_size) - 1;
+  CHECK(powmod(ones - 2, ones - 5, ones) == reference(ones - 2, ones - 5, ones));
+  BigInteger prime("170141183460469231731687303715884105727");  // 2^127 - 1
+  CHECK(powmod(BigInteger(3), prime - 1, prime) == 1);
+  CHECK(powmod(BigInteger(5), BigInteger(0), prime) == 1);
+  CHECK(powmod(BigInteger(5), BigInteger(0), BigInteger(1)) == 0);
+  CHECK(powmod(BigInteger(-2), BigInteger(3), BigInteger(10)) == 2);
+  CHECK(powmod(BigInteger(3), BigInteger(5), left_shift(BigInteger(1), 100)) == 243);
+  CHECK(powmod(BigInteger(6), BigInteger(200), BigInteger(96)) == reference(6, 200, 96));
+  CHECK_THROWS(powmod(BigInteger(2), BigInteger(-1), prime));
+  CHECK_THROWS(powmod(BigInteger(2), BigInteger(3), BigInteger(0)));
+
+  Montgomery context(prime);
+  BigInteger a("123456789123456789123456789"), b("987654321987654321987654321");
+  BigInteger product = context.multiply(context.to_montgomery(a), context.to_montgomery(b));
+  CHECK(context.from_montgomery(product) == a * b % prime);
+  CHECK(context.from_montgomery(context.square(context.to_montgomery(a))) == a * a % prime);
+  CHECK(context.to_montgomery(prime) == 0);
+  CHECK_THROWS(Montgomery(BigInteger(10)));
+}
+
+TEST_CASE("Barrett reduction", "[BigInteger]") {
+  std::mt19937_64 rng(24);
+  for (size_t size : std::initializer_list<size_t>{1, 2, 3, 8, 40, 130}) {
+    BigInteger mod = random_big(rng, size);
+    BarrettReducer reducer(mod);
+    std::vector<BigInteger> values;
+    for (int i = 0; i < 8; ++i) {
+      BigInteger value = random_big(rng, 2 * size) % (mod * mod);
+      if (i == 1) value = mod * mod - 1;
+      if (i == 2) value = mod;
+      if (i == 3) value = random_big(rng, 3 * size);
+      if (i == 4) value = -value;
+      BigInteger expected = value % mod;
+      if (expected.negative) expected += mod;
+      CHECK(reducer.reduce(value) == expected);
+      values.push_back(value);
+    }
+    std::vector<BigInteger> reduced = values;
+    reducer.reduce(std::span<BigInteger>(reduced));
+    for (size_t i = 0; i < values.size(); ++i) CHECK(reduced[i] == reducer.reduce(values[i]));
+  }
+  // Short products: the low one exact, the high one short by less than n B + n
+  size_t saved_karatsuba = karatsuba_threshold;
+  for (size_t threshold : {saved_karatsuba, size_t(4)}) {
+    karatsuba_threshold = threshold;
+    for (auto [lhs_size, rhs_size] : {std::pair<size_t, size_t>{150, 150}, {151, 120}, {40, 300}}) {
+      BigInteger a = random_big(rng, lhs_size), b = random_big(rng, rhs_size);
+      BigInteger product = a * b;
+      for (size_t n : {size_t(1), lhs_size / 2, lhs_size, lhs_size + rhs_size + 3}) {
+        CHECK(BigInteger::mul_low(a, b, n) == product.slice(0, n));
+        BigInteger exact = product.slice(n, product.size()), high = BigInteger::mul_high(a, b, n);
+        BigInteger bound(static_cast<int64_t>(std::min(lhs_size, rhs_size)));
+        CHECK(high <= exact);
+        CHECK(exact - high < left_shift(bound, digit_size) + bound);
+      }
+    }
+    BigInteger mod = random_big(rng, 150), value = random_big(rng, 300);
+    CHECK(BarrettReducer(mod).reduce(value) == value % mod);
+  }
+  karatsuba_threshold = saved_karatsuba;
+  // mu of a modulus B^k - 1 is B^k + 1, the estimate is furthest below the quotient
+  BigInteger ones = left_shift(BigInteger(1), 4 * digit_size) - 1;
+  BarrettReducer reducer(ones);
+  CHECK(reducer.reduce(ones * ones - 1) == (ones * ones - 1) % ones);
+  CHECK(reducer.reduce(BigInteger(0)) == 0);
+  CHECK(BarrettReducer(BigInteger(1)).reduce(BigInteger(12345)) == 0);
+  CHECK_THROWS(BarrettReducer(BigInteger(0)));
+  CHECK_THROWS(BarrettReducer(BigInteger(-7)));
+}
+
+TEST_CASE("Special form modulus reduction", "[BigInteger]") {
+  auto power = [](size_t bits) { return left_shift(BigInteger(1), bits); };
+  std::vector<BigInteger> moduli = {power(127) - 1, power(521) - 1, power(255) - 19,
+                                    power(192) - 237, power(130) + 5, power(200) + 1,
+                                    power(64) - 59, power(3 * digit_size) - 1, power(96)};
+  std::mt19937_64 rng(25);
+  size_t saved_threshold = special_modulus_threshold;
+  special_modulus_threshold = 1;
+  for (const BigInteger &mod : moduli) {
+    REQUIRE(SpecialModulusReducer::is_special(mod));
+    SpecialModulusReducer reducer(mod);
+    std::vector<BigInteger> values;
+    for (int i = 0; i < 8; ++i) {
+      BigInteger value = random_big(rng, 2 * mod.size()) % (mod * mod);
+      if (i == 1) value = mod * mod - 1;
+      if (i == 2) value = mod;
+      if (i == 3) value = mod - 1;
+      if (i == 4) value = random_big(rng, 5 * mod.size());
+      if (i == 5) value = -value;
+      BigInteger expected = value % mod;
+      if (expected.negative) expected += mod;
+      CHECK(reducer.reduce(value) == expected);
+      CHECK(value % reducer == expected);
+      values.push_back(value);
+    }
+    reducer.reduce(std::span<BigInteger>(values));
+    for (const BigInteger &value : values) CHECK((value >= 0 && value < mod));
+    BigInteger base = random_big(rng, mod.size()), exp = random_big(rng, 2);
+    BigInteger expected = window_pow(
+        base % mod, exp, [&](const BigInteger &x) { return x * x % mod; },
+        [&](const BigInteger &x, const BigInteger &y) { return x * y % mod; });
+    CHECK(powmod(base, exp, mod) == expected);
+  }
+  special_modulus_threshold = saved_threshold;
+  CHECK(BigInteger(12345) % BarrettReducer(BigInteger(1000)) == 345);
+  CHECK(powmod(BigInteger(3), power(127) - 2, power(127) - 1) == 1);
+  CHECK(powmod(BigInteger(7), BigInteger(0), power(89) - 1) == 1);
+  CHECK_FALSE(SpecialModulusReducer::is_special(power(100) - power(80)));
+  CHECK_FALSE(SpecialModulusReducer::is_special(BigInteger(0)));
+  CHECK_THROWS(SpecialModulusReducer(power(128) + power(100)));
+}